@@ -0,0 +1,139 @@
+#ifndef MARKOVCHAIN_SCORER_H
+#define MARKOVCHAIN_SCORER_H
+
+// Scoring of next states and sequences under a discrete time Markov chain.
+// The header only depends on the standard library, so packages declaring
+// LinkingTo: markovchain can build a Scorer from their own data or take the
+// one behind a markovchainScorer R object:
+//
+//   Rcpp::S4 object(x);
+//   Rcpp::XPtr<markovchain::Scorer> scorer(object.slot("pointer"));
+//
+// A Scorer is never modified after its construction: all its methods are
+// const and can be called from several threads at the same time, with no R
+// API involved
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace markovchain {
+
+class Scorer {
+public:
+  // states: the names of the n states
+  // probs: the transition probabilities, row-major, n * n
+  // floor: every transition gets at least this probability before each row
+  //   is normalised again, so that unseen transitions are not impossible
+  // k: the number of most probable successors kept for each state
+  Scorer(const std::vector<std::string>& states, const std::vector<double>& probs,
+         double floor = 0, int k = 10)
+    : names(states), n(states.size()) {
+    if (probs.size() != n * n)
+      throw std::invalid_argument("probs must have one entry per pair of states");
+  
+    if (!(floor >= 0))
+      throw std::invalid_argument("floor must be non negative");
+  
+    if (k < 0)
+      throw std::invalid_argument("k must be non negative");
+  
+    numTop = std::min<std::size_t>(k, n);
+  
+    for (std::size_t i = 0; i < n; ++i)
+      if (!positions.emplace(states[i], i).second)
+        throw std::invalid_argument("states must be unique");
+  
+    logProbs.resize(n * n);
+    top.resize(n * numTop);
+    std::vector<int> order(n);
+  
+    for (std::size_t i = 0; i < n; ++i) {
+      double* row = &logProbs[i * n];
+      double total = 0;
+  
+      for (std::size_t j = 0; j < n; ++j) {
+        row[j] = std::max(probs[i * n + j], floor);
+        total += row[j];
+      }
+  
+      for (std::size_t j = 0; j < n; ++j)
+        row[j] = std::log(row[j] / total);
+  
+      // Most probable successors first, ties in the order of the states
+      for (std::size_t j = 0; j < n; ++j)
+        order[j] = j;
+  
+      std::stable_sort(order.begin(), order.end(), [row](int a, int b) {
+        return row[a] > row[b];
+      });
+  
+      std::copy(order.begin(), order.begin() + numTop, top.begin() + i * numTop);
+    }
+  }
+  
+  std::size_t size() const {
+    return n;
+  }
+  
+  const std::string& state(int i) const {
+    return names[i];
+  }
+  
+  // Position of a state, -1 if it is not a state of the chain
+  int index(const std::string& name) const {
+    auto it = positions.find(name);
+  
+    return it == positions.end() ? -1 : it->second;
+  }
+  
+  // Log-probabilities of moving from state i to each state
+  const double* logRow(int i) const {
+    return &logProbs[i * n];
+  }
+  
+  double logProb(int from, int to) const {
+    return logProbs[from * n + to];
+  }
+  
+  std::size_t numSuccessors() const {
+    return numTop;
+  }
+  
+  // The numSuccessors() most probable successors of state i, in decreasing
+  // order of probability
+  const int* successors(int i) const {
+    return &top[i * numTop];
+  }
+  
+  // Log-likelihood of the transitions of a sequence of state positions.
+  // Transitions from or to a negative position (a missing state) are skipped
+  double logLikelihood(const int* sequence, std::size_t length) const {
+    double result = 0;
+  
+    for (std::size_t t = 1; t < length; ++t)
+      if (sequence[t - 1] >= 0 && sequence[t] >= 0)
+        result += logProbs[sequence[t - 1] * n + sequence[t]];
+  
+    return result;
+  }
+  
+  double logLikelihood(const std::vector<int>& sequence) const {
+    return logLikelihood(sequence.data(), sequence.size());
+  }
+
+private:
+  std::vector<std::string> names;
+  std::unordered_map<std::string, int> positions;
+  std::size_t n, numTop;
+  std::vector<double> logProbs;
+  std::vector<int> top;
+};
+
+}
+
+#endif
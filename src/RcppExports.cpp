@@ -17,6 +17,20 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// predictRcpp
+List predictRcpp(List chains, List histories, int nAhead, bool continuation);
+RcppExport SEXP _markovchain_predictRcpp(SEXP chainsSEXP, SEXP historiesSEXP, SEXP nAheadSEXP, SEXP continuationSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type chains(chainsSEXP);
+    Rcpp::traits::input_parameter< List >::type histories(historiesSEXP);
+    Rcpp::traits::input_parameter< int >::type nAhead(nAheadSEXP);
+    Rcpp::traits::input_parameter< bool >::type continuation(continuationSEXP);
+    rcpp_result_gen = Rcpp::wrap(predictRcpp(chains, histories, nAhead, continuation));
+    return rcpp_result_gen;
+END_RCPP
+}
 // generatorToTransitionMatrix
 NumericMatrix generatorToTransitionMatrix(NumericMatrix gen, bool byrow);
 RcppExport SEXP _markovchain_generatorToTransitionMatrix(SEXP genSEXP, SEXP byrowSEXP) {
@@ -29,6 +43,45 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// isCTMCIrreducible
+bool isCTMCIrreducible(SEXP gen, bool byrow);
+RcppExport SEXP _markovchain_isCTMCIrreducible(SEXP genSEXP, SEXP byrowSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type gen(genSEXP);
+    Rcpp::traits::input_parameter< bool >::type byrow(byrowSEXP);
+    rcpp_result_gen = Rcpp::wrap(isCTMCIrreducible(gen, byrow));
+    return rcpp_result_gen;
+END_RCPP
+}
+// ctmcSteadyStatesRcpp
+NumericMatrix ctmcSteadyStatesRcpp(SEXP gen, bool byrow, double tolerance, int maxit);
+RcppExport SEXP _markovchain_ctmcSteadyStatesRcpp(SEXP genSEXP, SEXP byrowSEXP, SEXP toleranceSEXP, SEXP maxitSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type gen(genSEXP);
+    Rcpp::traits::input_parameter< bool >::type byrow(byrowSEXP);
+    Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
+    Rcpp::traits::input_parameter< int >::type maxit(maxitSEXP);
+    rcpp_result_gen = Rcpp::wrap(ctmcSteadyStatesRcpp(gen, byrow, tolerance, maxit));
+    return rcpp_result_gen;
+END_RCPP
+}
+// isCTMCReversible
+bool isCTMCReversible(SEXP gen, bool byrow, double tolerance);
+RcppExport SEXP _markovchain_isCTMCReversible(SEXP genSEXP, SEXP byrowSEXP, SEXP toleranceSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type gen(genSEXP);
+    Rcpp::traits::input_parameter< bool >::type byrow(byrowSEXP);
+    Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
+    rcpp_result_gen = Rcpp::wrap(isCTMCReversible(gen, byrow, tolerance));
+    return rcpp_result_gen;
+END_RCPP
+}
 // ctmcFit
 List ctmcFit(List data, bool byrow, String name, double confidencelevel);
 RcppExport SEXP _markovchain_ctmcFit(SEXP dataSEXP, SEXP byrowSEXP, SEXP nameSEXP, SEXP confidencelevelSEXP) {
@@ -43,6 +96,35 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// ctmcFitPanel
+List ctmcFitPanel(List data, bool byrow, String name, NumericMatrix initialGenerator, int maxit, double tolerance);
+RcppExport SEXP _markovchain_ctmcFitPanel(SEXP dataSEXP, SEXP byrowSEXP, SEXP nameSEXP, SEXP initialGeneratorSEXP, SEXP maxitSEXP, SEXP toleranceSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< bool >::type byrow(byrowSEXP);
+    Rcpp::traits::input_parameter< String >::type name(nameSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type initialGenerator(initialGeneratorSEXP);
+    Rcpp::traits::input_parameter< int >::type maxit(maxitSEXP);
+    Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
+    rcpp_result_gen = Rcpp::wrap(ctmcFitPanel(data, byrow, name, initialGenerator, maxit, tolerance));
+    return rcpp_result_gen;
+END_RCPP
+}
+// smmFit
+List smmFit(List data, String distribution, bool perTransition);
+RcppExport SEXP _markovchain_smmFit(SEXP dataSEXP, SEXP distributionSEXP, SEXP perTransitionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< String >::type distribution(distributionSEXP);
+    Rcpp::traits::input_parameter< bool >::type perTransition(perTransitionSEXP);
+    rcpp_result_gen = Rcpp::wrap(smmFit(data, distribution, perTransition));
+    return rcpp_result_gen;
+END_RCPP
+}
 // ExpectedTimeRcpp
 NumericVector ExpectedTimeRcpp(NumericMatrix x, NumericVector y);
 RcppExport SEXP _markovchain_ExpectedTimeRcpp(SEXP xSEXP, SEXP ySEXP) {
@@ -81,6 +163,64 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// freq2GeneratorRcpp
+List freq2GeneratorRcpp(NumericVector P, double t, String method, String logmethod);
+RcppExport SEXP _markovchain_freq2GeneratorRcpp(SEXP PSEXP, SEXP tSEXP, SEXP methodSEXP, SEXP logmethodSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type P(PSEXP);
+    Rcpp::traits::input_parameter< double >::type t(tSEXP);
+    Rcpp::traits::input_parameter< String >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< String >::type logmethod(logmethodSEXP);
+    rcpp_result_gen = Rcpp::wrap(freq2GeneratorRcpp(P, t, method, logmethod));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rsmm
+DataFrame rsmm(int n, List model, CharacterVector t0, int paths, double T);
+RcppExport SEXP _markovchain_rsmm(SEXP nSEXP, SEXP modelSEXP, SEXP t0SEXP, SEXP pathsSEXP, SEXP TSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< List >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type t0(t0SEXP);
+    Rcpp::traits::input_parameter< int >::type paths(pathsSEXP);
+    Rcpp::traits::input_parameter< double >::type T(TSEXP);
+    rcpp_result_gen = Rcpp::wrap(rsmm(n, model, t0, paths, T));
+    return rcpp_result_gen;
+END_RCPP
+}
+// smmOccupancy
+NumericMatrix smmOccupancy(List model, double horizon, double step, NumericVector initialDistribution);
+RcppExport SEXP _markovchain_smmOccupancy(SEXP modelSEXP, SEXP horizonSEXP, SEXP stepSEXP, SEXP initialDistributionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< double >::type horizon(horizonSEXP);
+    Rcpp::traits::input_parameter< double >::type step(stepSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type initialDistribution(initialDistributionSEXP);
+    rcpp_result_gen = Rcpp::wrap(smmOccupancy(model, horizon, step, initialDistribution));
+    return rcpp_result_gen;
+END_RCPP
+}
+// ctmcBridge
+DataFrame ctmcBridge(S4 ctmc, String from, String to, double T, int paths);
+RcppExport SEXP _markovchain_ctmcBridge(SEXP ctmcSEXP, SEXP fromSEXP, SEXP toSEXP, SEXP TSEXP, SEXP pathsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< S4 >::type ctmc(ctmcSEXP);
+    Rcpp::traits::input_parameter< String >::type from(fromSEXP);
+    Rcpp::traits::input_parameter< String >::type to(toSEXP);
+    Rcpp::traits::input_parameter< double >::type T(TSEXP);
+    Rcpp::traits::input_parameter< int >::type paths(pathsSEXP);
+    rcpp_result_gen = Rcpp::wrap(ctmcBridge(ctmc, from, to, T, paths));
+    return rcpp_result_gen;
+END_RCPP
+}
 // seq2freqProb
 NumericVector seq2freqProb(CharacterVector sequence);
 RcppExport SEXP _markovchain_seq2freqProb(SEXP sequenceSEXP) {
@@ -146,6 +286,21 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// markovchainBridge
+CharacterMatrix markovchainBridge(S4 markovchain, String from, String to, int n, int paths);
+RcppExport SEXP _markovchain_markovchainBridge(SEXP markovchainSEXP, SEXP fromSEXP, SEXP toSEXP, SEXP nSEXP, SEXP pathsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< S4 >::type markovchain(markovchainSEXP);
+    Rcpp::traits::input_parameter< String >::type from(fromSEXP);
+    Rcpp::traits::input_parameter< String >::type to(toSEXP);
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< int >::type paths(pathsSEXP);
+    rcpp_result_gen = Rcpp::wrap(markovchainBridge(markovchain, from, to, n, paths));
+    return rcpp_result_gen;
+END_RCPP
+}
 // createSequenceMatrix
 NumericMatrix createSequenceMatrix(SEXP stringchar, bool toRowProbs, bool sanitize, CharacterVector possibleStates);
 RcppExport SEXP _markovchain_createSequenceMatrix(SEXP stringcharSEXP, SEXP toRowProbsSEXP, SEXP sanitizeSEXP, SEXP possibleStatesSEXP) {
@@ -234,15 +389,16 @@ BEGIN_RCPP
 END_RCPP
 }
 // noofVisitsDistRCpp
-NumericVector noofVisitsDistRCpp(NumericMatrix matrix, int i, int N);
-RcppExport SEXP _markovchain_noofVisitsDistRCpp(SEXP matrixSEXP, SEXP iSEXP, SEXP NSEXP) {
+NumericMatrix noofVisitsDistRCpp(NumericMatrix matrix, bool byrow, IntegerVector origins, int N);
+RcppExport SEXP _markovchain_noofVisitsDistRCpp(SEXP matrixSEXP, SEXP byrowSEXP, SEXP originsSEXP, SEXP NSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< NumericMatrix >::type matrix(matrixSEXP);
-    Rcpp::traits::input_parameter< int >::type i(iSEXP);
+    Rcpp::traits::input_parameter< bool >::type byrow(byrowSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type origins(originsSEXP);
     Rcpp::traits::input_parameter< int >::type N(NSEXP);
-    rcpp_result_gen = Rcpp::wrap(noofVisitsDistRCpp(matrix, i, N));
+    rcpp_result_gen = Rcpp::wrap(noofVisitsDistRCpp(matrix, byrow, origins, N));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -271,158 +427,248 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
-// commClassesKernel
-List commClassesKernel(NumericMatrix P);
-RcppExport SEXP _markovchain_commClassesKernel(SEXP PSEXP) {
+// commClassesKernelRcpp
+List commClassesKernelRcpp(SEXP P);
+RcppExport SEXP _markovchain_commClassesKernelRcpp(SEXP PSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type P(PSEXP);
+    rcpp_result_gen = Rcpp::wrap(commClassesKernelRcpp(P));
+    return rcpp_result_gen;
+END_RCPP
+}
+// compileMarkovchain
+SEXP compileMarkovchain(S4 object);
+RcppExport SEXP _markovchain_compileMarkovchain(SEXP objectSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    rcpp_result_gen = Rcpp::wrap(compileMarkovchain(object));
+    return rcpp_result_gen;
+END_RCPP
+}
+// projectDistributions
+arma::cube projectDistributions(List matrices, NumericMatrix initial, IntegerVector horizons, int start);
+RcppExport SEXP _markovchain_projectDistributions(SEXP matricesSEXP, SEXP initialSEXP, SEXP horizonsSEXP, SEXP startSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< NumericMatrix >::type P(PSEXP);
-    rcpp_result_gen = Rcpp::wrap(commClassesKernel(P));
+    Rcpp::traits::input_parameter< List >::type matrices(matricesSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type initial(initialSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type horizons(horizonsSEXP);
+    Rcpp::traits::input_parameter< int >::type start(startSEXP);
+    rcpp_result_gen = Rcpp::wrap(projectDistributions(matrices, initial, horizons, start));
+    return rcpp_result_gen;
+END_RCPP
+}
+// markovchainListIndex
+SEXP markovchainListIndex(S4 object);
+RcppExport SEXP _markovchain_markovchainListIndex(SEXP objectSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    rcpp_result_gen = Rcpp::wrap(markovchainListIndex(object));
+    return rcpp_result_gen;
+END_RCPP
+}
+// intervalTransitions
+List intervalTransitions(SEXP obj, IntegerVector from, IntegerVector to);
+RcppExport SEXP _markovchain_intervalTransitions(SEXP objSEXP, SEXP fromSEXP, SEXP toSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type from(fromSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type to(toSEXP);
+    rcpp_result_gen = Rcpp::wrap(intervalTransitions(obj, from, to));
+    return rcpp_result_gen;
+END_RCPP
+}
+// transitionPowers
+List transitionPowers(SEXP obj, IntegerVector horizons, NumericMatrix initial, String method);
+RcppExport SEXP _markovchain_transitionPowers(SEXP objSEXP, SEXP horizonsSEXP, SEXP initialSEXP, SEXP methodSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type horizons(horizonsSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type initial(initialSEXP);
+    Rcpp::traits::input_parameter< String >::type method(methodSEXP);
+    rcpp_result_gen = Rcpp::wrap(transitionPowers(obj, horizons, initial, method));
     return rcpp_result_gen;
 END_RCPP
 }
 // communicatingClasses
-List communicatingClasses(S4 object);
+List communicatingClasses(SEXP object);
 RcppExport SEXP _markovchain_communicatingClasses(SEXP objectSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type object(objectSEXP);
     rcpp_result_gen = Rcpp::wrap(communicatingClasses(object));
     return rcpp_result_gen;
 END_RCPP
 }
 // transientStates
-CharacterVector transientStates(S4 object);
+CharacterVector transientStates(SEXP object);
 RcppExport SEXP _markovchain_transientStates(SEXP objectSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type object(objectSEXP);
     rcpp_result_gen = Rcpp::wrap(transientStates(object));
     return rcpp_result_gen;
 END_RCPP
 }
 // recurrentStates
-CharacterVector recurrentStates(S4 object);
+CharacterVector recurrentStates(SEXP object);
 RcppExport SEXP _markovchain_recurrentStates(SEXP objectSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type object(objectSEXP);
     rcpp_result_gen = Rcpp::wrap(recurrentStates(object));
     return rcpp_result_gen;
 END_RCPP
 }
 // recurrentClasses
-List recurrentClasses(S4 object);
+List recurrentClasses(SEXP object);
 RcppExport SEXP _markovchain_recurrentClasses(SEXP objectSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type object(objectSEXP);
     rcpp_result_gen = Rcpp::wrap(recurrentClasses(object));
     return rcpp_result_gen;
 END_RCPP
 }
 // transientClasses
-List transientClasses(S4 object);
+List transientClasses(SEXP object);
 RcppExport SEXP _markovchain_transientClasses(SEXP objectSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type object(objectSEXP);
     rcpp_result_gen = Rcpp::wrap(transientClasses(object));
     return rcpp_result_gen;
 END_RCPP
 }
 // reachabilityMatrix
-LogicalMatrix reachabilityMatrix(S4 obj);
+LogicalMatrix reachabilityMatrix(SEXP obj);
 RcppExport SEXP _markovchain_reachabilityMatrix(SEXP objSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
     rcpp_result_gen = Rcpp::wrap(reachabilityMatrix(obj));
     return rcpp_result_gen;
 END_RCPP
 }
+// reachable
+LogicalVector reachable(SEXP obj, IntegerVector from, IntegerVector to);
+RcppExport SEXP _markovchain_reachable(SEXP objSEXP, SEXP fromSEXP, SEXP toSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type from(fromSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type to(toSEXP);
+    rcpp_result_gen = Rcpp::wrap(reachable(obj, from, to));
+    return rcpp_result_gen;
+END_RCPP
+}
 // isAccessible
-bool isAccessible(S4 obj, String from, String to);
+LogicalVector isAccessible(SEXP obj, CharacterVector from, CharacterVector to);
 RcppExport SEXP _markovchain_isAccessible(SEXP objSEXP, SEXP fromSEXP, SEXP toSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type obj(objSEXP);
-    Rcpp::traits::input_parameter< String >::type from(fromSEXP);
-    Rcpp::traits::input_parameter< String >::type to(toSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type from(fromSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type to(toSEXP);
     rcpp_result_gen = Rcpp::wrap(isAccessible(obj, from, to));
     return rcpp_result_gen;
 END_RCPP
 }
 // summaryKernel
-List summaryKernel(S4 object);
+List summaryKernel(SEXP object);
 RcppExport SEXP _markovchain_summaryKernel(SEXP objectSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type object(objectSEXP);
     rcpp_result_gen = Rcpp::wrap(summaryKernel(object));
     return rcpp_result_gen;
 END_RCPP
 }
-// firstpassageKernel
-NumericMatrix firstpassageKernel(NumericMatrix P, int i, int n);
-RcppExport SEXP _markovchain_firstpassageKernel(SEXP PSEXP, SEXP iSEXP, SEXP nSEXP) {
+// firstPassage
+NumericMatrix firstPassage(SEXP obj, IntegerVector origins, List sets, int n);
+RcppExport SEXP _markovchain_firstPassage(SEXP objSEXP, SEXP originsSEXP, SEXP setsSEXP, SEXP nSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< NumericMatrix >::type P(PSEXP);
-    Rcpp::traits::input_parameter< int >::type i(iSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type origins(originsSEXP);
+    Rcpp::traits::input_parameter< List >::type sets(setsSEXP);
     Rcpp::traits::input_parameter< int >::type n(nSEXP);
-    rcpp_result_gen = Rcpp::wrap(firstpassageKernel(P, i, n));
+    rcpp_result_gen = Rcpp::wrap(firstPassage(obj, origins, sets, n));
     return rcpp_result_gen;
 END_RCPP
 }
-// firstPassageMultipleRCpp
-NumericVector firstPassageMultipleRCpp(NumericMatrix P, int i, NumericVector setno, int n);
-RcppExport SEXP _markovchain_firstPassageMultipleRCpp(SEXP PSEXP, SEXP iSEXP, SEXP setnoSEXP, SEXP nSEXP) {
+// expectedRewardsRCpp
+NumericMatrix expectedRewardsRCpp(SEXP obj, int n, NumericMatrix rewards, double discount);
+RcppExport SEXP _markovchain_expectedRewardsRCpp(SEXP objSEXP, SEXP nSEXP, SEXP rewardsSEXP, SEXP discountSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< NumericMatrix >::type P(PSEXP);
-    Rcpp::traits::input_parameter< int >::type i(iSEXP);
-    Rcpp::traits::input_parameter< NumericVector >::type setno(setnoSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
     Rcpp::traits::input_parameter< int >::type n(nSEXP);
-    rcpp_result_gen = Rcpp::wrap(firstPassageMultipleRCpp(P, i, setno, n));
+    Rcpp::traits::input_parameter< NumericMatrix >::type rewards(rewardsSEXP);
+    Rcpp::traits::input_parameter< double >::type discount(discountSEXP);
+    rcpp_result_gen = Rcpp::wrap(expectedRewardsRCpp(obj, n, rewards, discount));
     return rcpp_result_gen;
 END_RCPP
 }
-// expectedRewardsRCpp
-NumericVector expectedRewardsRCpp(NumericMatrix matrix, int n, NumericVector rewards);
-RcppExport SEXP _markovchain_expectedRewardsRCpp(SEXP matrixSEXP, SEXP nSEXP, SEXP rewardsSEXP) {
+// discountedRewardsRCpp
+NumericMatrix discountedRewardsRCpp(SEXP obj, NumericMatrix rewards, double discount);
+RcppExport SEXP _markovchain_discountedRewardsRCpp(SEXP objSEXP, SEXP rewardsSEXP, SEXP discountSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< NumericMatrix >::type matrix(matrixSEXP);
-    Rcpp::traits::input_parameter< int >::type n(nSEXP);
-    Rcpp::traits::input_parameter< NumericVector >::type rewards(rewardsSEXP);
-    rcpp_result_gen = Rcpp::wrap(expectedRewardsRCpp(matrix, n, rewards));
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type rewards(rewardsSEXP);
+    Rcpp::traits::input_parameter< double >::type discount(discountSEXP);
+    rcpp_result_gen = Rcpp::wrap(discountedRewardsRCpp(obj, rewards, discount));
+    return rcpp_result_gen;
+END_RCPP
+}
+// averageRewardsRCpp
+List averageRewardsRCpp(SEXP obj, NumericMatrix rewards);
+RcppExport SEXP _markovchain_averageRewardsRCpp(SEXP objSEXP, SEXP rewardsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type rewards(rewardsSEXP);
+    rcpp_result_gen = Rcpp::wrap(averageRewardsRCpp(obj, rewards));
     return rcpp_result_gen;
 END_RCPP
 }
 // expectedRewardsBeforeHittingARCpp
-double expectedRewardsBeforeHittingARCpp(NumericMatrix matrix, int s0, NumericVector rewards, int n);
-RcppExport SEXP _markovchain_expectedRewardsBeforeHittingARCpp(SEXP matrixSEXP, SEXP s0SEXP, SEXP rewardsSEXP, SEXP nSEXP) {
+NumericVector expectedRewardsBeforeHittingARCpp(SEXP obj, IntegerVector A, int s0, NumericMatrix rewards, int n);
+RcppExport SEXP _markovchain_expectedRewardsBeforeHittingARCpp(SEXP objSEXP, SEXP ASEXP, SEXP s0SEXP, SEXP rewardsSEXP, SEXP nSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< NumericMatrix >::type matrix(matrixSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type A(ASEXP);
     Rcpp::traits::input_parameter< int >::type s0(s0SEXP);
-    Rcpp::traits::input_parameter< NumericVector >::type rewards(rewardsSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type rewards(rewardsSEXP);
     Rcpp::traits::input_parameter< int >::type n(nSEXP);
-    rcpp_result_gen = Rcpp::wrap(expectedRewardsBeforeHittingARCpp(matrix, s0, rewards, n));
+    rcpp_result_gen = Rcpp::wrap(expectedRewardsBeforeHittingARCpp(obj, A, s0, rewards, n));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -439,16 +685,27 @@ BEGIN_RCPP
 END_RCPP
 }
 // period
-int period(S4 object);
+int period(SEXP object);
 RcppExport SEXP _markovchain_period(SEXP objectSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type object(objectSEXP);
     rcpp_result_gen = Rcpp::wrap(period(object));
     return rcpp_result_gen;
 END_RCPP
 }
+// classPeriods
+List classPeriods(SEXP object);
+RcppExport SEXP _markovchain_classPeriods(SEXP objectSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type object(objectSEXP);
+    rcpp_result_gen = Rcpp::wrap(classPeriods(object));
+    return rcpp_result_gen;
+END_RCPP
+}
 // predictiveDistribution
 double predictiveDistribution(CharacterVector stringchar, CharacterVector newData, NumericMatrix hyperparam);
 RcppExport SEXP _markovchain_predictiveDistribution(SEXP stringcharSEXP, SEXP newDataSEXP, SEXP hyperparamSEXP) {
@@ -475,127 +732,222 @@ BEGIN_RCPP
 END_RCPP
 }
 // hittingProbabilities
-NumericMatrix hittingProbabilities(S4 object);
+NumericMatrix hittingProbabilities(SEXP object);
 RcppExport SEXP _markovchain_hittingProbabilities(SEXP objectSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type object(objectSEXP);
     rcpp_result_gen = Rcpp::wrap(hittingProbabilities(object));
     return rcpp_result_gen;
 END_RCPP
 }
 // canonicForm
-S4 canonicForm(S4 obj);
+S4 canonicForm(SEXP obj);
 RcppExport SEXP _markovchain_canonicForm(SEXP objSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
     rcpp_result_gen = Rcpp::wrap(canonicForm(obj));
     return rcpp_result_gen;
 END_RCPP
 }
 // steadyStates
-NumericMatrix steadyStates(S4 obj);
-RcppExport SEXP _markovchain_steadyStates(SEXP objSEXP) {
+NumericMatrix steadyStates(SEXP obj, String method, double tolerance, int maxit, double omega, bool diagnostics);
+RcppExport SEXP _markovchain_steadyStates(SEXP objSEXP, SEXP methodSEXP, SEXP toleranceSEXP, SEXP maxitSEXP, SEXP omegaSEXP, SEXP diagnosticsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type obj(objSEXP);
-    rcpp_result_gen = Rcpp::wrap(steadyStates(obj));
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< String >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
+    Rcpp::traits::input_parameter< int >::type maxit(maxitSEXP);
+    Rcpp::traits::input_parameter< double >::type omega(omegaSEXP);
+    Rcpp::traits::input_parameter< bool >::type diagnostics(diagnosticsSEXP);
+    rcpp_result_gen = Rcpp::wrap(steadyStates(obj, method, tolerance, maxit, omega, diagnostics));
     return rcpp_result_gen;
 END_RCPP
 }
 // absorbingStates
-CharacterVector absorbingStates(S4 obj);
+CharacterVector absorbingStates(SEXP obj);
 RcppExport SEXP _markovchain_absorbingStates(SEXP objSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
     rcpp_result_gen = Rcpp::wrap(absorbingStates(obj));
     return rcpp_result_gen;
 END_RCPP
 }
 // isIrreducible
-bool isIrreducible(S4 obj);
+bool isIrreducible(SEXP obj);
 RcppExport SEXP _markovchain_isIrreducible(SEXP objSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
     rcpp_result_gen = Rcpp::wrap(isIrreducible(obj));
     return rcpp_result_gen;
 END_RCPP
 }
 // isRegular
-bool isRegular(S4 obj);
-RcppExport SEXP _markovchain_isRegular(SEXP objSEXP) {
+bool isRegular(SEXP obj, bool powers);
+RcppExport SEXP _markovchain_isRegular(SEXP objSEXP, SEXP powersSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type obj(objSEXP);
-    rcpp_result_gen = Rcpp::wrap(isRegular(obj));
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< bool >::type powers(powersSEXP);
+    rcpp_result_gen = Rcpp::wrap(isRegular(obj, powers));
     return rcpp_result_gen;
 END_RCPP
 }
 // meanAbsorptionTime
-NumericVector meanAbsorptionTime(S4 obj);
+NumericVector meanAbsorptionTime(SEXP obj);
 RcppExport SEXP _markovchain_meanAbsorptionTime(SEXP objSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
     rcpp_result_gen = Rcpp::wrap(meanAbsorptionTime(obj));
     return rcpp_result_gen;
 END_RCPP
 }
 // absorptionProbabilities
-NumericMatrix absorptionProbabilities(S4 obj);
+NumericMatrix absorptionProbabilities(SEXP obj);
 RcppExport SEXP _markovchain_absorptionProbabilities(SEXP objSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
     rcpp_result_gen = Rcpp::wrap(absorptionProbabilities(obj));
     return rcpp_result_gen;
 END_RCPP
 }
+// varianceAbsorptionTime
+NumericVector varianceAbsorptionTime(SEXP obj);
+RcppExport SEXP _markovchain_varianceAbsorptionTime(SEXP objSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
+    rcpp_result_gen = Rcpp::wrap(varianceAbsorptionTime(obj));
+    return rcpp_result_gen;
+END_RCPP
+}
+// fundamentalMatrix
+NumericMatrix fundamentalMatrix(SEXP obj, CharacterVector states);
+RcppExport SEXP _markovchain_fundamentalMatrix(SEXP objSEXP, SEXP statesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type states(statesSEXP);
+    rcpp_result_gen = Rcpp::wrap(fundamentalMatrix(obj, states));
+    return rcpp_result_gen;
+END_RCPP
+}
+// absorptionTimeDistribution
+List absorptionTimeDistribution(SEXP obj, int n, NumericMatrix initial, double tolerance);
+RcppExport SEXP _markovchain_absorptionTimeDistribution(SEXP objSEXP, SEXP nSEXP, SEXP initialSEXP, SEXP toleranceSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type initial(initialSEXP);
+    Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
+    rcpp_result_gen = Rcpp::wrap(absorptionTimeDistribution(obj, n, initial, tolerance));
+    return rcpp_result_gen;
+END_RCPP
+}
 // meanFirstPassageTime
-NumericMatrix meanFirstPassageTime(S4 obj, CharacterVector destination);
-RcppExport SEXP _markovchain_meanFirstPassageTime(SEXP objSEXP, SEXP destinationSEXP) {
+NumericMatrix meanFirstPassageTime(SEXP obj, CharacterVector destination, CharacterVector targets);
+RcppExport SEXP _markovchain_meanFirstPassageTime(SEXP objSEXP, SEXP destinationSEXP, SEXP targetsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
     Rcpp::traits::input_parameter< CharacterVector >::type destination(destinationSEXP);
-    rcpp_result_gen = Rcpp::wrap(meanFirstPassageTime(obj, destination));
+    Rcpp::traits::input_parameter< CharacterVector >::type targets(targetsSEXP);
+    rcpp_result_gen = Rcpp::wrap(meanFirstPassageTime(obj, destination, targets));
     return rcpp_result_gen;
 END_RCPP
 }
 // meanRecurrenceTime
-NumericVector meanRecurrenceTime(S4 obj);
+NumericVector meanRecurrenceTime(SEXP obj);
 RcppExport SEXP _markovchain_meanRecurrenceTime(SEXP objSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
     rcpp_result_gen = Rcpp::wrap(meanRecurrenceTime(obj));
     return rcpp_result_gen;
 END_RCPP
 }
 // meanNumVisits
-NumericMatrix meanNumVisits(S4 obj);
+NumericMatrix meanNumVisits(SEXP obj);
 RcppExport SEXP _markovchain_meanNumVisits(SEXP objSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type obj(objSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type obj(objSEXP);
     rcpp_result_gen = Rcpp::wrap(meanNumVisits(obj));
     return rcpp_result_gen;
 END_RCPP
 }
+// compileScorer
+SEXP compileScorer(S4 object, double floor, int k);
+RcppExport SEXP _markovchain_compileScorer(SEXP objectSEXP, SEXP floorSEXP, SEXP kSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    Rcpp::traits::input_parameter< double >::type floor(floorSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    rcpp_result_gen = Rcpp::wrap(compileScorer(object, floor, k));
+    return rcpp_result_gen;
+END_RCPP
+}
+// nextStateProbabilities
+NumericMatrix nextStateProbabilities(S4 object, CharacterVector from, bool logarithm);
+RcppExport SEXP _markovchain_nextStateProbabilities(SEXP objectSEXP, SEXP fromSEXP, SEXP logarithmSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type from(fromSEXP);
+    Rcpp::traits::input_parameter< bool >::type logarithm(logarithmSEXP);
+    rcpp_result_gen = Rcpp::wrap(nextStateProbabilities(object, from, logarithm));
+    return rcpp_result_gen;
+END_RCPP
+}
+// topSuccessors
+List topSuccessors(S4 object, CharacterVector from, int k);
+RcppExport SEXP _markovchain_topSuccessors(SEXP objectSEXP, SEXP fromSEXP, SEXP kSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type from(fromSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    rcpp_result_gen = Rcpp::wrap(topSuccessors(object, from, k));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sequenceLogLikelihood
+NumericVector sequenceLogLikelihood(S4 object, List sequences);
+RcppExport SEXP _markovchain_sequenceLogLikelihood(SEXP objectSEXP, SEXP sequencesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< S4 >::type object(objectSEXP);
+    Rcpp::traits::input_parameter< List >::type sequences(sequencesSEXP);
+    rcpp_result_gen = Rcpp::wrap(sequenceLogLikelihood(object, sequences));
+    return rcpp_result_gen;
+END_RCPP
+}
 // isProb
 bool isProb(double prob);
 RcppExport SEXP _markovchain_isProb(SEXP probSEXP) {
@@ -630,17 +982,6 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
-// checkIsAccesibleMethod
-bool checkIsAccesibleMethod(S4 obj);
-RcppExport SEXP _markovchain_checkIsAccesibleMethod(SEXP objSEXP) {
-BEGIN_RCPP
-    Rcpp::RObject rcpp_result_gen;
-    Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< S4 >::type obj(objSEXP);
-    rcpp_result_gen = Rcpp::wrap(checkIsAccesibleMethod(obj));
-    return rcpp_result_gen;
-END_RCPP
-}
 // approxEqual
 bool approxEqual(NumericMatrix a, NumericMatrix b);
 RcppExport SEXP _markovchain_approxEqual(SEXP aSEXP, SEXP bSEXP) {
@@ -732,57 +1073,82 @@ END_RCPP
 
 static const R_CallMethodDef CallEntries[] = {
     {"_markovchain_isGen", (DL_FUNC) &_markovchain_isGen, 1},
+    {"_markovchain_predictRcpp", (DL_FUNC) &_markovchain_predictRcpp, 4},
     {"_markovchain_generatorToTransitionMatrix", (DL_FUNC) &_markovchain_generatorToTransitionMatrix, 2},
+    {"_markovchain_isCTMCIrreducible", (DL_FUNC) &_markovchain_isCTMCIrreducible, 2},
+    {"_markovchain_ctmcSteadyStatesRcpp", (DL_FUNC) &_markovchain_ctmcSteadyStatesRcpp, 4},
+    {"_markovchain_isCTMCReversible", (DL_FUNC) &_markovchain_isCTMCReversible, 3},
     {"_markovchain_ctmcFit", (DL_FUNC) &_markovchain_ctmcFit, 4},
+    {"_markovchain_ctmcFitPanel", (DL_FUNC) &_markovchain_ctmcFitPanel, 6},
+    {"_markovchain_smmFit", (DL_FUNC) &_markovchain_smmFit, 3},
     {"_markovchain_ExpectedTimeRcpp", (DL_FUNC) &_markovchain_ExpectedTimeRcpp, 2},
     {"_markovchain_probabilityatTRCpp", (DL_FUNC) &_markovchain_probabilityatTRCpp, 1},
     {"_markovchain_impreciseProbabilityatTRCpp", (DL_FUNC) &_markovchain_impreciseProbabilityatTRCpp, 5},
+    {"_markovchain_freq2GeneratorRcpp", (DL_FUNC) &_markovchain_freq2GeneratorRcpp, 4},
+    {"_markovchain_rsmm", (DL_FUNC) &_markovchain_rsmm, 5},
+    {"_markovchain_smmOccupancy", (DL_FUNC) &_markovchain_smmOccupancy, 4},
+    {"_markovchain_ctmcBridge", (DL_FUNC) &_markovchain_ctmcBridge, 5},
     {"_markovchain_seq2freqProb", (DL_FUNC) &_markovchain_seq2freqProb, 1},
     {"_markovchain_seq2matHigh", (DL_FUNC) &_markovchain_seq2matHigh, 2},
     {"_markovchain_markovchainSequenceRcpp", (DL_FUNC) &_markovchain_markovchainSequenceRcpp, 4},
     {"_markovchain_markovchainListRcpp", (DL_FUNC) &_markovchain_markovchainListRcpp, 4},
     {"_markovchain_markovchainSequenceParallelRcpp", (DL_FUNC) &_markovchain_markovchainSequenceParallelRcpp, 4},
+    {"_markovchain_markovchainBridge", (DL_FUNC) &_markovchain_markovchainBridge, 5},
     {"_markovchain_createSequenceMatrix", (DL_FUNC) &_markovchain_createSequenceMatrix, 4},
     {"_markovchain_mcListFitForList", (DL_FUNC) &_markovchain_mcListFitForList, 1},
     {"_markovchain__matr2Mc", (DL_FUNC) &_markovchain__matr2Mc, 4},
     {"_markovchain__list2Mc", (DL_FUNC) &_markovchain__list2Mc, 3},
     {"_markovchain_inferHyperparam", (DL_FUNC) &_markovchain_inferHyperparam, 3},
     {"_markovchain_markovchainFit", (DL_FUNC) &_markovchain_markovchainFit, 12},
-    {"_markovchain_noofVisitsDistRCpp", (DL_FUNC) &_markovchain_noofVisitsDistRCpp, 3},
+    {"_markovchain_noofVisitsDistRCpp", (DL_FUNC) &_markovchain_noofVisitsDistRCpp, 4},
     {"_markovchain_multinomialCIForRow", (DL_FUNC) &_markovchain_multinomialCIForRow, 2},
     {"_markovchain_multinomCI", (DL_FUNC) &_markovchain_multinomCI, 3},
-    {"_markovchain_commClassesKernel", (DL_FUNC) &_markovchain_commClassesKernel, 1},
+    {"_markovchain_commClassesKernelRcpp", (DL_FUNC) &_markovchain_commClassesKernelRcpp, 1},
+    {"_markovchain_compileMarkovchain", (DL_FUNC) &_markovchain_compileMarkovchain, 1},
+    {"_markovchain_projectDistributions", (DL_FUNC) &_markovchain_projectDistributions, 4},
+    {"_markovchain_markovchainListIndex", (DL_FUNC) &_markovchain_markovchainListIndex, 1},
+    {"_markovchain_intervalTransitions", (DL_FUNC) &_markovchain_intervalTransitions, 3},
+    {"_markovchain_transitionPowers", (DL_FUNC) &_markovchain_transitionPowers, 4},
     {"_markovchain_communicatingClasses", (DL_FUNC) &_markovchain_communicatingClasses, 1},
     {"_markovchain_transientStates", (DL_FUNC) &_markovchain_transientStates, 1},
     {"_markovchain_recurrentStates", (DL_FUNC) &_markovchain_recurrentStates, 1},
     {"_markovchain_recurrentClasses", (DL_FUNC) &_markovchain_recurrentClasses, 1},
     {"_markovchain_transientClasses", (DL_FUNC) &_markovchain_transientClasses, 1},
     {"_markovchain_reachabilityMatrix", (DL_FUNC) &_markovchain_reachabilityMatrix, 1},
+    {"_markovchain_reachable", (DL_FUNC) &_markovchain_reachable, 3},
     {"_markovchain_isAccessible", (DL_FUNC) &_markovchain_isAccessible, 3},
     {"_markovchain_summaryKernel", (DL_FUNC) &_markovchain_summaryKernel, 1},
-    {"_markovchain_firstpassageKernel", (DL_FUNC) &_markovchain_firstpassageKernel, 3},
-    {"_markovchain_firstPassageMultipleRCpp", (DL_FUNC) &_markovchain_firstPassageMultipleRCpp, 4},
-    {"_markovchain_expectedRewardsRCpp", (DL_FUNC) &_markovchain_expectedRewardsRCpp, 3},
-    {"_markovchain_expectedRewardsBeforeHittingARCpp", (DL_FUNC) &_markovchain_expectedRewardsBeforeHittingARCpp, 4},
+    {"_markovchain_firstPassage", (DL_FUNC) &_markovchain_firstPassage, 4},
+    {"_markovchain_expectedRewardsRCpp", (DL_FUNC) &_markovchain_expectedRewardsRCpp, 4},
+    {"_markovchain_discountedRewardsRCpp", (DL_FUNC) &_markovchain_discountedRewardsRCpp, 3},
+    {"_markovchain_averageRewardsRCpp", (DL_FUNC) &_markovchain_averageRewardsRCpp, 2},
+    {"_markovchain_expectedRewardsBeforeHittingARCpp", (DL_FUNC) &_markovchain_expectedRewardsBeforeHittingARCpp, 5},
     {"_markovchain_gcd", (DL_FUNC) &_markovchain_gcd, 2},
     {"_markovchain_period", (DL_FUNC) &_markovchain_period, 1},
+    {"_markovchain_classPeriods", (DL_FUNC) &_markovchain_classPeriods, 1},
     {"_markovchain_predictiveDistribution", (DL_FUNC) &_markovchain_predictiveDistribution, 3},
     {"_markovchain_priorDistribution", (DL_FUNC) &_markovchain_priorDistribution, 2},
     {"_markovchain_hittingProbabilities", (DL_FUNC) &_markovchain_hittingProbabilities, 1},
     {"_markovchain_canonicForm", (DL_FUNC) &_markovchain_canonicForm, 1},
-    {"_markovchain_steadyStates", (DL_FUNC) &_markovchain_steadyStates, 1},
+    {"_markovchain_steadyStates", (DL_FUNC) &_markovchain_steadyStates, 6},
     {"_markovchain_absorbingStates", (DL_FUNC) &_markovchain_absorbingStates, 1},
     {"_markovchain_isIrreducible", (DL_FUNC) &_markovchain_isIrreducible, 1},
-    {"_markovchain_isRegular", (DL_FUNC) &_markovchain_isRegular, 1},
+    {"_markovchain_isRegular", (DL_FUNC) &_markovchain_isRegular, 2},
     {"_markovchain_meanAbsorptionTime", (DL_FUNC) &_markovchain_meanAbsorptionTime, 1},
     {"_markovchain_absorptionProbabilities", (DL_FUNC) &_markovchain_absorptionProbabilities, 1},
-    {"_markovchain_meanFirstPassageTime", (DL_FUNC) &_markovchain_meanFirstPassageTime, 2},
+    {"_markovchain_varianceAbsorptionTime", (DL_FUNC) &_markovchain_varianceAbsorptionTime, 1},
+    {"_markovchain_fundamentalMatrix", (DL_FUNC) &_markovchain_fundamentalMatrix, 2},
+    {"_markovchain_absorptionTimeDistribution", (DL_FUNC) &_markovchain_absorptionTimeDistribution, 4},
+    {"_markovchain_meanFirstPassageTime", (DL_FUNC) &_markovchain_meanFirstPassageTime, 3},
     {"_markovchain_meanRecurrenceTime", (DL_FUNC) &_markovchain_meanRecurrenceTime, 1},
     {"_markovchain_meanNumVisits", (DL_FUNC) &_markovchain_meanNumVisits, 1},
+    {"_markovchain_compileScorer", (DL_FUNC) &_markovchain_compileScorer, 3},
+    {"_markovchain_nextStateProbabilities", (DL_FUNC) &_markovchain_nextStateProbabilities, 3},
+    {"_markovchain_topSuccessors", (DL_FUNC) &_markovchain_topSuccessors, 3},
+    {"_markovchain_sequenceLogLikelihood", (DL_FUNC) &_markovchain_sequenceLogLikelihood, 2},
     {"_markovchain_isProb", (DL_FUNC) &_markovchain_isProb, 1},
     {"_markovchain_isStochasticMatrix", (DL_FUNC) &_markovchain_isStochasticMatrix, 2},
     {"_markovchain_isProbVector", (DL_FUNC) &_markovchain_isProbVector, 1},
-    {"_markovchain_checkIsAccesibleMethod", (DL_FUNC) &_markovchain_checkIsAccesibleMethod, 1},
     {"_markovchain_approxEqual", (DL_FUNC) &_markovchain_approxEqual, 2},
     {"_markovchain_isPartition", (DL_FUNC) &_markovchain_isPartition, 2},
     {"_markovchain_areHittingProbabilities", (DL_FUNC) &_markovchain_areHittingProbabilities, 3},
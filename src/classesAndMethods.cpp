@@ -3,6 +3,7 @@
 #include <functional>
 #include <unordered_map>
 #include <string>
+#include <vector>
 using namespace Rcpp;
 using namespace arma;
 using namespace std;
@@ -17,4 +18,91 @@ bool isGen(NumericMatrix gen) {
         return false;
 
   return true;
-}
\ No newline at end of file
+}
+
+// Predicts the modal path of many histories through a sequence of chains
+// (a single chain for a markovchain). The most probable successors of every
+// state, with their ties, are found once per chain. Step i of a history of
+// length n follows the chain n + i - 1, or the last one past the end of the
+// sequence if continuation is true; otherwise the prediction stops there.
+// Ties are broken at random
+// [[Rcpp::export(.predictRcpp)]]
+List predictRcpp(List chains, List histories, int nAhead, bool continuation) {
+  int numChains = chains.size();
+  vector<CharacterVector> states(numChains);
+  vector<unordered_map<string, int>> positions(numChains);
+  vector<vector<vector<int>>> modes(numChains);
+  // Index of each state of a chain among the states of the next one
+  vector<vector<int>> translation(numChains);
+  
+  for (int k = 0; k < numChains; ++k) {
+    S4 chain = chains[k];
+    NumericMatrix transitions = chain.slot("transitionMatrix");
+    bool byrow = chain.slot("byrow");
+    states[k] = chain.slot("states");
+    int numStates = states[k].size();
+    modes[k].resize(numStates);
+    
+    for (int i = 0; i < numStates; ++i) {
+      positions[k][(string) states[k](i)] = i;
+      double best = R_NegInf;
+      
+      for (int j = 0; j < numStates; ++j) {
+        double prob = byrow ? transitions(i, j) : transitions(j, i);
+        
+        if (prob > best) {
+          best = prob;
+          modes[k][i].clear();
+        }
+        
+        if (prob == best)
+          modes[k][i].push_back(j);
+      }
+    }
+  }
+  
+  for (int k = 0; k + 1 < numChains; ++k) {
+    for (int j = 0; j < states[k].size(); ++j) {
+      auto it = positions[k + 1].find((string) states[k](j));
+      translation[k].push_back(it == positions[k + 1].end() ? -1 : it->second);
+    }
+  }
+  
+  List result(histories.size());
+  
+  for (int h = 0; h < histories.size(); ++h) {
+    CharacterVector history = histories[h];
+    
+    if (history.size() == 0)
+      stop("newdata must contain at least one state");
+    
+    int first = history.size() - 1;
+    int steps = continuation ? nAhead : std::max(0, std::min(nAhead, numChains - first));
+    int previous = -1, current = -1;
+    CharacterVector out(steps);
+    
+    for (int i = 0; i < steps; ++i) {
+      int chain = std::min(first + i, numChains - 1);
+      
+      if (previous < 0) {
+        auto it = positions[chain].find((string) history(first));
+        current = it == positions[chain].end() ? -1 : it->second;
+      } else if (chain != previous) {
+        current = translation[previous][current];
+      }
+      
+      if (current < 0)
+        stop("The last state is not a state of the markovchain used to predict");
+      
+      const vector<int>& ties = modes[chain][current];
+      int pick = ties.size() == 1 ? 0 : (int) (R::unif_rand() * ties.size());
+      current = ties[std::min<int>(pick, ties.size() - 1)];
+      out[i] = states[chain](current);
+      previous = chain;
+    }
+    
+    result[h] = out;
+  }
+  
+  return result;
+}
@@ -1,5 +1,13 @@
-#include <Rcpp.h>
+// [[Rcpp::depends(RcppArmadillo)]]
+#include <RcppArmadillo.h>
+#include <vector>
 using namespace Rcpp;
+using namespace arma;
+using namespace std;
+
+// Declared in utils.cpp
+int stronglyConnectedComponents(const vector<int>& offsets, const vector<int>& targets,
+                                vector<int>& component, vector<bool>& closed);
 
 //' @name generatorToTransitionMatrix
 //' @title Function to obtain the transition matrix from the generator
@@ -48,3 +56,223 @@ NumericMatrix generatorToTransitionMatrix(NumericMatrix gen, bool byrow = true){
   
   return transMatr;
 }
+
+
+// Generator as a sparse matrix whose column i holds the rates out of state i.
+// Accepts both dense matrices and dgCMatrix objects
+sp_mat outgoingRates(SEXP gen, bool byrow) {
+  sp_mat rates;
+  
+  if (Rf_isMatrix(gen))
+    rates = sp_mat(as<mat>(gen));
+  else if (Rf_inherits(gen, "dgCMatrix"))
+    rates = as<sp_mat>(gen);
+  else
+    stop("gen must be either a matrix or a dgCMatrix");
+  
+  if (rates.n_rows != rates.n_cols)
+    stop("gen must be a square matrix");
+  
+  if (byrow)
+    return rates.t();
+  else
+    return rates;
+}
+
+// Communicating classes of the chain, built from the sparsity pattern 
+// of the off-diagonal rates. Returns the number of classes
+int generatorClasses(const sp_mat& outgoing, vector<int>& component, vector<bool>& closed) {
+  int m = outgoing.n_cols;
+  vector<int> offsets(m + 1, 0);
+  vector<int> targets;
+  targets.reserve(outgoing.n_nonzero);
+  
+  for (int i = 0; i < m; ++i) {
+    for (auto it = outgoing.begin_col(i); it != outgoing.end_col(i); ++it)
+      if ((int) it.row() != i && (*it) > 0)
+        targets.push_back(it.row());
+    
+    offsets[i + 1] = targets.size();
+  }
+  
+  return stronglyConnectedComponents(offsets, targets, component, closed);
+}
+
+// Stationary distribution of a closed class with the Grassmann-Taksar-Heyman
+// algorithm. Only uses off-diagonal rates, so it involves no subtractions
+vec gthSteadyState(const sp_mat& outgoing, const uvec& members) {
+  int k = members.n_elem;
+  mat rates(k, k, fill::zeros);
+  
+  for (int i = 0; i < k; ++i)
+    for (int j = 0; j < k; ++j)
+      if (i != j)
+        rates(i, j) = outgoing(members(j), members(i));
+  
+  for (int n = k - 1; n > 0; --n) {
+    double exitRate = 0;
+    
+    for (int j = 0; j < n; ++j)
+      exitRate += rates(n, j);
+    
+    for (int i = 0; i < n; ++i)
+      rates(i, n) /= exitRate;
+    
+    for (int i = 0; i < n; ++i)
+      for (int j = 0; j < n; ++j)
+        if (i != j)
+          rates(i, j) += rates(i, n) * rates(n, j);
+  }
+  
+  vec pi(k, fill::zeros);
+  pi(0) = 1;
+  
+  for (int j = 1; j < k; ++j)
+    for (int i = 0; i < j; ++i)
+      pi(j) += pi(i) * rates(i, j);
+  
+  return pi / accu(pi);
+}
+
+// Stationary distribution of a closed class with Gauss-Seidel sweeps over
+// the sparse rates, for classes too large for a dense elimination
+vec gaussSeidelSteadyState(const sp_mat& outgoing, const sp_mat& incoming, const uvec& members,
+                           const vector<int>& position, double tolerance, int maxit) {
+  int k = members.n_elem;
+  vec exitRate(k, fill::zeros);
+  vec pi(k);
+  pi.fill(1.0 / k);
+  
+  for (int i = 0; i < k; ++i)
+    for (auto it = outgoing.begin_col(members(i)); it != outgoing.end_col(members(i)); ++it)
+      if (it.row() != members(i))
+        exitRate(i) += (*it);
+  
+  bool converged = false;
+  
+  for (int iter = 0; iter < maxit && !converged; ++iter) {
+    double change = 0;
+    
+    for (int j = 0; j < k; ++j) {
+      double inflow = 0;
+      
+      for (auto it = incoming.begin_col(members(j)); it != incoming.end_col(members(j)); ++it)
+        if (position[it.row()] >= 0 && it.row() != members(j))
+          inflow += pi(position[it.row()]) * (*it);
+      
+      double updated = inflow / exitRate(j);
+      change = std::max(change, std::abs(updated - pi(j)));
+      pi(j) = updated;
+    }
+    
+    pi /= accu(pi);
+    converged = change <= tolerance;
+  }
+  
+  if (!converged)
+    warning("Steady state solver did not converge in %d iterations", maxit);
+  
+  return pi;
+}
+
+// Stationary distributions of every closed class, one per row
+mat ctmcSteadyStates(const sp_mat& outgoing, double tolerance, int maxit) {
+  // Largest class solved with a dense elimination
+  const int denseLimit = 1000;
+  int m = outgoing.n_cols;
+  vector<int> component;
+  vector<bool> closed;
+  int numClasses = generatorClasses(outgoing, component, closed);
+  vector<vector<uword>> members(numClasses);
+  
+  for (int i = 0; i < m; ++i)
+    if (closed[component[i]])
+      members[component[i]].push_back(i);
+  
+  int numClosed = 0;
+  
+  for (int c = 0; c < numClasses; ++c)
+    if (closed[c])
+      ++numClosed;
+  
+  mat result(numClosed, m, fill::zeros);
+  sp_mat incoming;
+  vector<int> position;
+  int row = 0;
+  
+  for (int c = 0; c < numClasses; ++c) {
+    if (!closed[c])
+      continue;
+    
+    uvec classMembers(members[c]);
+    vec pi;
+    
+    if ((int) classMembers.n_elem <= denseLimit) {
+      pi = gthSteadyState(outgoing, classMembers);
+    } else {
+      if (position.empty()) {
+        incoming = outgoing.t();
+        position.assign(m, -1);
+      }
+      
+      for (uword i = 0; i < classMembers.n_elem; ++i)
+        position[classMembers(i)] = i;
+      
+      pi = gaussSeidelSteadyState(outgoing, incoming, classMembers, position, tolerance, maxit);
+      
+      for (uword i = 0; i < classMembers.n_elem; ++i)
+        position[classMembers(i)] = -1;
+    }
+    
+    for (uword i = 0; i < classMembers.n_elem; ++i)
+      result(row, classMembers(i)) = pi(i);
+    
+    ++row;
+  }
+  
+  return result;
+}
+
+// [[Rcpp::export(.isCTMCIrreducibleRcpp)]]
+bool isCTMCIrreducible(SEXP gen, bool byrow = true) {
+  sp_mat outgoing = outgoingRates(gen, byrow);
+  vector<int> component;
+  vector<bool> closed;
+  
+  return generatorClasses(outgoing, component, closed) <= 1;
+}
+
+// [[Rcpp::export(.ctmcSteadyStatesRcpp)]]
+NumericMatrix ctmcSteadyStatesRcpp(SEXP gen, bool byrow = true, double tolerance = 1e-12, int maxit = 10000) {
+  sp_mat outgoing = outgoingRates(gen, byrow);
+  
+  return wrap(ctmcSteadyStates(outgoing, tolerance, maxit));
+}
+
+// Checks the detailed balance equations pi_i q_ij = pi_j q_ji for the
+// stationary distribution of every closed class, over the non-zero rates
+// [[Rcpp::export(.isCTMCReversibleRcpp)]]
+bool isCTMCReversible(SEXP gen, bool byrow = true, double tolerance = 1e-8) {
+  sp_mat outgoing = outgoingRates(gen, byrow);
+  mat steadyStates = ctmcSteadyStates(outgoing, 1e-12, 10000);
+  int m = outgoing.n_cols;
+  
+  for (uword s = 0; s < steadyStates.n_rows; ++s) {
+    for (int i = 0; i < m; ++i) {
+      for (auto it = outgoing.begin_col(i); it != outgoing.end_col(i); ++it) {
+        int j = it.row();
+        
+        if (j == i)
+          continue;
+        
+        double forward = steadyStates(s, i) * (*it);
+        double backward = steadyStates(s, j) * outgoing(i, j);
+        
+        if (std::abs(forward - backward) > tolerance * std::max(forward, backward))
+          return false;
+      }
+    }
+  }
+  
+  return true;
+}
@@ -1,7 +1,17 @@
-#include <Rcpp.h>
+// [[Rcpp::depends(RcppArmadillo)]]
+// [[Rcpp::depends(RcppParallel)]]
+#include <RcppArmadillo.h>
+#include <RcppParallel.h>
+#include <algorithm>
 #include <ctime>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 using namespace Rcpp;
+using namespace RcppParallel;
+using namespace std;
 
 #include <math.h>
 
@@ -11,6 +21,9 @@ List markovchainFit(SEXP data, String method = "mle", bool byrow = true,
                     NumericMatrix hyperparam = NumericMatrix(), bool sanitize = false,
                     CharacterVector possibleStates = CharacterVector()); 
 
+NumericMatrix createSequenceMatrix(SEXP stringchar, bool toRowProbs = false, bool sanitize = false,
+                                   CharacterVector possibleStates = CharacterVector());
+
 //' @name ctmcFit
 //' @title Function to fit a CTMC
 //' @description This function fits the underlying CTMC give the state
@@ -107,3 +120,611 @@ List ctmcFit(List data, bool byrow=true, String name="", double confidencelevel
                               _["upperEndpointVector"] = upperConfVecLambda))
                       );
 }
+
+
+// Worker that evaluates the panel log-likelihood, score and Fisher
+// information for every group of observations sharing the same elapsed
+// time. exp(Q t) and its derivatives are computed once per group and
+// the groups are processed in parallel
+struct PanelLikelihood : public Worker {
+  // current generator (by rows)
+  const arma::mat& Q;
+  
+  // distinct elapsed times, one per group
+  const vector<double>& times;
+  
+  // slice g holds the transition counts observed after times[g]
+  const arma::cube& counts;
+  
+  // free parameters: q_{from[u], to[u]} = exp(theta_u)
+  const vector<int>& from;
+  const vector<int>& to;
+  
+  // whether to compute the score and the Fisher information
+  const bool derivatives;
+  
+  // per group outputs
+  arma::vec& loglik;
+  arma::mat& score;
+  arma::cube& information;
+  
+  PanelLikelihood(const arma::mat& Q, const vector<double>& times, const arma::cube& counts,
+                  const vector<int>& from, const vector<int>& to, bool derivatives,
+                  arma::vec& loglik, arma::mat& score, arma::cube& information) :
+    Q(Q), times(times), counts(counts), from(from), to(to), derivatives(derivatives),
+    loglik(loglik), score(score), information(information) {}
+  
+  void operator()(std::size_t begin, std::size_t end) {
+    int m = Q.n_rows;
+    int numParams = from.size();
+    
+    for (std::size_t g = begin; g < end; ++g) {
+      const arma::mat& n = counts.slice(g);
+      arma::mat A = Q * times[g];
+      arma::mat P;
+      
+      if (!arma::expmat(P, A)) {
+        loglik(g) = -arma::datum::inf;
+        continue;
+      }
+      
+      // Avoid log(0) for transitions which the current generator makes impossible
+      P.transform([](double x) { return x < 1E-300 ? 1E-300 : x; });
+      loglik(g) = arma::accu(n % arma::log(P));
+      
+      if (!derivatives)
+        continue;
+      
+      arma::vec originCount = arma::sum(n, 1);
+      arma::cube dP(m, m, numParams);
+      bool failed = false;
+      
+      // Derivative of exp(Q t) with respect to theta_u through the block
+      // matrix exp([A E; 0 A]), whose upper right block is the Frechet
+      // derivative of exp at A in the direction E (Van Loan, 1978)
+      for (int u = 0; u < numParams; ++u) {
+        arma::mat block(2 * m, 2 * m, arma::fill::zeros);
+        double rate = Q(from[u], to[u]) * times[g];
+        block(arma::span(0, m - 1), arma::span(0, m - 1)) = A;
+        block(arma::span(m, 2 * m - 1), arma::span(m, 2 * m - 1)) = A;
+        block(from[u], m + to[u]) = rate;
+        block(from[u], m + from[u]) = -rate;
+        
+        arma::mat blockExp;
+        
+        if (!arma::expmat(blockExp, block)) {
+          failed = true;
+          break;
+        }
+        
+        dP.slice(u) = blockExp(arma::span(0, m - 1), arma::span(m, 2 * m - 1));
+      }
+      
+      if (failed) {
+        loglik(g) = -arma::datum::inf;
+        continue;
+      }
+      
+      for (int u = 0; u < numParams; ++u) {
+        score(u, g) = arma::accu(n % dP.slice(u) / P);
+        
+        for (int v = u; v < numParams; ++v) {
+          double value = 0;
+          
+          for (int i = 0; i < m; ++i)
+            if (originCount(i) > 0)
+              for (int j = 0; j < m; ++j)
+                value += originCount(i) * dP(i, j, u) * dP(i, j, v) / P(i, j);
+          
+          information(u, v, g) = value;
+          information(v, u, g) = value;
+        }
+      }
+    }
+  }
+};
+
+// Evaluates the panel likelihood (and optionally its derivatives) for the
+// parameters theta, summing the contributions of every elapsed time group
+double panelLoglikelihood(const arma::vec& theta, arma::mat& Q, const vector<double>& times,
+                          const arma::cube& counts, const vector<int>& from, const vector<int>& to,
+                          bool derivatives, arma::vec& score, arma::mat& information) {
+  int numGroups = times.size();
+  int numParams = theta.n_elem;
+  
+  Q.zeros();
+  
+  for (int u = 0; u < numParams; ++u) {
+    Q(from[u], to[u]) = exp(theta(u));
+    Q(from[u], from[u]) -= exp(theta(u));
+  }
+  
+  arma::vec loglik(numGroups, arma::fill::zeros);
+  arma::mat groupScore(numParams, derivatives ? numGroups : 0, arma::fill::zeros);
+  arma::cube groupInformation(numParams, numParams, derivatives ? numGroups : 0, arma::fill::zeros);
+  
+  PanelLikelihood worker(Q, times, counts, from, to, derivatives, loglik, groupScore, groupInformation);
+  parallelFor(0, numGroups, worker);
+  
+  if (derivatives) {
+    score = arma::sum(groupScore, 1);
+    information.zeros(numParams, numParams);
+    
+    for (int g = 0; g < numGroups; ++g)
+      information += groupInformation.slice(g);
+  }
+  
+  return arma::accu(loglik);
+}
+
+//' @name ctmcFitPanel
+//' @title Function to fit a CTMC from panel data
+//' @description This function fits a CTMC generator by maximum likelihood
+//'   when the process is only observed at (possibly irregular) snapshot times,
+//'   so the exact jump times required by \code{\link{ctmcFit}} are unknown
+//' @usage ctmcFitPanel(data, byrow = TRUE, name = "", initialGenerator = matrix(),
+//'   maxit = 100L, tolerance = 1e-8)
+//' @param data It is a list of three elements. The first element is a
+//'   character vector with the states at the start of each observation
+//'   interval, the second a character vector with the states at its end and
+//'   the third a numeric vector with the elapsed time of each interval.
+//' @param byrow Determines if the output generator is by row.
+//' @param name Optional name for the CTMC.
+//' @param initialGenerator Optional starting generator (by rows, with states
+//'   as dimnames). Off-diagonal entries equal to zero are kept fixed at zero,
+//'   so it can be used to constrain the allowed transitions.
+//' @param maxit Maximum number of scoring iterations.
+//' @param tolerance Relative tolerance on the log-likelihood change used to
+//'   declare convergence.
+//' @return It returns a list containing the estimated CTMC, the
+//'   log-likelihood, the standard errors of the rates, the number of
+//'   iterations and whether the algorithm converged.
+//' 
+//' @details The likelihood of each observed pair is \eqn{P_{ij}(\Delta t) =
+//'   \exp(Q \Delta t)_{ij}}. It is maximised with Fisher scoring on the log
+//'   rates (Kalbfleisch and Lawless, 1985). Observations are grouped by
+//'   distinct elapsed time, so each matrix exponential and its derivatives are
+//'   computed once per group and iteration, and the groups are evaluated in
+//'   parallel. States never observed at the start of an interval are estimated
+//'   as absorbing.
+//' @references Kalbfleisch, J. D. and Lawless, J. F. (1985). The analysis of
+//'   panel data under a Markov assumption. Journal of the American Statistical
+//'   Association, 80(392), 863-871.
+//' @seealso \code{\link{ctmcFit}}, \code{\link{freq2Generator}}
+//' 
+//' @examples
+//' data <- list(c("a", "a", "b", "b", "a", "c", "b", "a"),
+//'              c("b", "a", "c", "b", "c", "c", "a", "a"),
+//'              c(1, 0.5, 1, 2, 1, 0.5, 1, 2))
+//' ctmcFitPanel(data)
+//' 
+//' @export
+//' 
+// [[Rcpp::export]]
+List ctmcFitPanel(List data, bool byrow = true, String name = "",
+                  NumericMatrix initialGenerator = NumericMatrix(),
+                  int maxit = 100, double tolerance = 1e-8) {
+  if (data.size() < 3)
+    stop("data must contain the initial states, the final states and the elapsed times");
+  
+  CharacterVector fromStates = data[0];
+  CharacterVector toStates = data[1];
+  NumericVector elapsed = data[2];
+  int numObs = fromStates.size();
+  
+  if (toStates.size() != numObs || elapsed.size() != numObs)
+    stop("The elements of data must have the same length");
+  
+  CharacterVector sortedStates = unique(union_(fromStates, toStates)).sort();
+  int m = sortedStates.size();
+  unordered_map<string, int> stateToIndex;
+  
+  for (int i = 0; i < m; ++i)
+    stateToIndex[(string) sortedStates[i]] = i;
+  
+  // Group the observations by distinct elapsed time
+  map<double, int> timeToGroup;
+  
+  for (int k = 0; k < numObs; ++k) {
+    if (!(elapsed[k] > 0))
+      stop("Elapsed times must be positive");
+    
+    if (timeToGroup.count(elapsed[k]) == 0) {
+      int group = timeToGroup.size();
+      timeToGroup[elapsed[k]] = group;
+    }
+  }
+  
+  int numGroups = timeToGroup.size();
+  vector<double> times(numGroups);
+  
+  for (auto it : timeToGroup)
+    times[it.second] = it.first;
+  
+  arma::cube counts(m, m, numGroups, arma::fill::zeros);
+  arma::vec exposure(m, arma::fill::zeros);
+  arma::mat totalCounts(m, m, arma::fill::zeros);
+  
+  for (int k = 0; k < numObs; ++k) {
+    int i = stateToIndex[(string) fromStates[k]];
+    int j = stateToIndex[(string) toStates[k]];
+    counts(i, j, timeToGroup[elapsed[k]]) += 1;
+    totalCounts(i, j) += 1;
+    exposure(i) += elapsed[k];
+  }
+  
+  // Allowed transitions, either given by the initial generator or every
+  // off-diagonal entry of a row observed at least once
+  bool hasInitial = initialGenerator.nrow() == m && initialGenerator.ncol() == m;
+  arma::mat initial(m, m, arma::fill::zeros);
+  
+  if (hasInitial) {
+    if (Rf_isNull(initialGenerator.attr("dimnames")))
+      stop("initialGenerator must have the states as dimnames");
+    
+    CharacterVector rowNames = rownames(initialGenerator);
+    CharacterVector colNames = colnames(initialGenerator);
+    
+    for (int r = 0; r < m; ++r) {
+      if (stateToIndex.count((string) rowNames[r]) == 0 || stateToIndex.count((string) colNames[r]) == 0)
+        stop("The states of initialGenerator must match the observed states");
+    }
+    
+    for (int r = 0; r < m; ++r)
+      for (int c = 0; c < m; ++c)
+        initial(stateToIndex[(string) rowNames[r]], stateToIndex[(string) colNames[c]]) = initialGenerator(r, c);
+  } else if (initialGenerator.nrow() > 1) {
+    stop("initialGenerator must be a square matrix over the observed states");
+  }
+  
+  vector<int> from, to;
+  vector<double> start;
+  
+  for (int i = 0; i < m; ++i) {
+    if (exposure(i) == 0)
+      continue;
+    
+    for (int j = 0; j < m; ++j) {
+      if (i == j)
+        continue;
+      
+      if (hasInitial) {
+        if (initial(i, j) > 0) {
+          from.push_back(i);
+          to.push_back(j);
+          start.push_back(initial(i, j));
+        }
+      } else {
+        // Crude estimate: observed jumps per unit of exposure, with a small
+        // offset so that unobserved transitions start at a positive rate
+        from.push_back(i);
+        to.push_back(j);
+        start.push_back((totalCounts(i, j) + 0.1) / exposure(i));
+      }
+    }
+  }
+  
+  int numParams = from.size();
+  arma::vec theta(numParams);
+  
+  for (int u = 0; u < numParams; ++u)
+    theta(u) = log(start[u]);
+  
+  arma::mat Q(m, m);
+  arma::vec score;
+  arma::mat information;
+  double loglik = panelLoglikelihood(theta, Q, times, counts, from, to, true, score, information);
+  bool converged = numParams == 0;
+  int iter = 0;
+  
+  // Fisher scoring with step halving
+  while (!converged && iter < maxit) {
+    ++iter;
+    arma::vec step;
+    arma::mat regularised = information;
+    double ridge = 1E-10 * std::max(1.0, arma::max(information.diag()));
+    
+    while (!arma::solve(step, regularised, score) || !step.is_finite()) {
+      regularised.diag() += ridge;
+      ridge *= 10;
+      
+      if (ridge > 1E10)
+        stop("Singular information matrix in ctmcFitPanel");
+    }
+    
+    // Bound the change in log rates to keep exp(Q t) well behaved
+    step = arma::clamp(step, -5.0, 5.0);
+    
+    arma::vec candidate;
+    arma::vec dummyScore;
+    arma::mat dummyInformation;
+    double candidateLoglik = -arma::datum::inf;
+    double factor = 1;
+    
+    for (int halving = 0; halving < 30; ++halving) {
+      candidate = theta + factor * step;
+      candidateLoglik = panelLoglikelihood(candidate, Q, times, counts, from, to, false,
+                                           dummyScore, dummyInformation);
+      
+      if (candidateLoglik >= loglik)
+        break;
+      
+      factor /= 2;
+    }
+    
+    // No fraction of the step improves the likelihood: stay at theta, 
+    // rebuilding the generator the candidates overwrote, and report 
+    // convergence only if the gain predicted for the step was negligible
+    if (!(candidateLoglik >= loglik)) {
+      panelLoglikelihood(theta, Q, times, counts, from, to, false, dummyScore, dummyInformation);
+      converged = arma::dot(score, step) / 2 <= tolerance * (fabs(loglik) + tolerance);
+      break;
+    }
+    
+    double change = candidateLoglik - loglik;
+    theta = candidate;
+    loglik = panelLoglikelihood(theta, Q, times, counts, from, to, true, score, information);
+    converged = change <= tolerance * (fabs(loglik) + tolerance);
+  }
+  
+  // Standard errors of the rates by the delta method, q = exp(theta)
+  NumericMatrix standardErrors(m, m);
+  arma::mat covariance;
+  bool invertible = numParams > 0 && arma::inv(covariance, information);
+  
+  for (int u = 0; u < numParams; ++u) {
+    double rate = exp(theta(u));
+    standardErrors(from[u], to[u]) = invertible && covariance(u, u) >= 0 ?
+                                     rate * sqrt(covariance(u, u)) : NA_REAL;
+  }
+  
+  NumericMatrix gen = wrap(Q);
+  gen.attr("dimnames") = List::create(sortedStates, sortedStates);
+  standardErrors.attr("dimnames") = List::create(sortedStates, sortedStates);
+  
+  if (!byrow) {
+    gen = transpose(gen);
+    standardErrors = transpose(standardErrors);
+  }
+  
+  S4 outCtmc("ctmc");
+  outCtmc.slot("states") = sortedStates;
+  outCtmc.slot("byrow") = byrow;
+  outCtmc.slot("generator") = gen;
+  outCtmc.slot("name") = name;
+  
+  return List::create(_["estimate"] = outCtmc,
+                      _["logLikelihood"] = loglik,
+                      _["standardErrors"] = standardErrors,
+                      _["iterations"] = iter,
+                      _["converged"] = converged);
+}
+
+
+// Maximum likelihood Weibull fit. The profile equation for the shape
+//   sum(x^k log x) / sum(x^k) - 1 / k - mean(log x) = 0
+// is increasing in k and is solved with a safeguarded Newton method
+void fitWeibull(const vector<double>& sojourns, double& shape, double& scale) {
+  int n = sojourns.size();
+  double mean = 0;
+  
+  for (double x : sojourns)
+    mean += x / n;
+  
+  // Work with x / mean to avoid overflows in x^k
+  vector<double> x(n), logX(n);
+  double meanLog = 0;
+  
+  for (int i = 0; i < n; ++i) {
+    x[i] = sojourns[i] / mean;
+    logX[i] = log(x[i]);
+    meanLog += logX[i] / n;
+  }
+  
+  shape = 1;
+  
+  for (int iter = 0; iter < 100; ++iter) {
+    double s0 = 0, s1 = 0, s2 = 0;
+    
+    for (int i = 0; i < n; ++i) {
+      double power = pow(x[i], shape);
+      s0 += power;
+      s1 += power * logX[i];
+      s2 += power * logX[i] * logX[i];
+    }
+    
+    double value = s1 / s0 - 1 / shape - meanLog;
+    double derivative = (s2 * s0 - s1 * s1) / (s0 * s0) + 1 / (shape * shape);
+    double updated = shape - value / derivative;
+    
+    if (updated <= 0)
+      updated = shape / 2;
+    
+    bool done = fabs(updated - shape) <= 1e-10 * shape;
+    shape = updated;
+    
+    if (done)
+      break;
+  }
+  
+  double s0 = 0;
+  
+  for (int i = 0; i < n; ++i)
+    s0 += pow(x[i], shape) / n;
+  
+  scale = mean * pow(s0, 1 / shape);
+}
+
+// Maximum likelihood gamma fit, solving log(k) - digamma(k) = log(mean) - mean(log x)
+// with Newton's method started at the Minka approximation
+void fitGamma(const vector<double>& sojourns, double& shape, double& scale) {
+  int n = sojourns.size();
+  double mean = 0, meanLog = 0;
+  
+  for (double x : sojourns) {
+    mean += x / n;
+    meanLog += log(x) / n;
+  }
+  
+  double s = log(mean) - meanLog;
+  shape = (3 - s + sqrt((s - 3) * (s - 3) + 24 * s)) / (12 * s);
+  
+  for (int iter = 0; iter < 100; ++iter) {
+    double value = log(shape) - R::digamma(shape) - s;
+    double derivative = 1 / shape - R::trigamma(shape);
+    double updated = shape - value / derivative;
+    
+    if (updated <= 0)
+      updated = shape / 2;
+    
+    bool done = fabs(updated - shape) <= 1e-10 * shape;
+    shape = updated;
+    
+    if (done)
+      break;
+  }
+  
+  scale = mean / shape;
+}
+
+//' @name smmFit
+//' @title Function to fit a semi-Markov model
+//' @description This function fits a semi-Markov model, that is, an embedded
+//'   jump chain together with non exponential sojourn time distributions,
+//'   from the same kind of data used by \code{\link{ctmcFit}}
+//' @usage smmFit(data, distribution = "weibull", perTransition = FALSE)
+//' @param data It is a list of two elements. The first element is a character
+//'   vector denoting the states. The second is a numeric vector denoting the
+//'   corresponding transition times.
+//' @param distribution Sojourn time distribution, one among "weibull",
+//'   "gamma", "exponential" and "empirical".
+//' @param perTransition If TRUE a sojourn distribution is fitted for each
+//'   observed transition, otherwise one for each state.
+//' @return It returns a list with the \code{states}, the transition matrix of
+//'   the embedded chain (\code{transitionMatrix}, by rows), the
+//'   \code{distribution}, \code{perTransition}, the fitted \code{parameters}
+//'   (shape and scale, one row per state or per pair of states) and the
+//'   observed \code{sojourns} of each row. The list can be passed to
+//'   \code{\link{rsmm}} and \code{\link{smmOccupancy}}.
+//' 
+//' @details The embedded chain is estimated from the transition counts
+//'   computed by \code{\link{createSequenceMatrix}}. Weibull and gamma
+//'   distributions are fitted by maximum likelihood; the exponential fit has
+//'   shape 1 and matches the rates given by \code{\link{ctmcFit}}. Groups
+//'   with less than two distinct sojourn times get an exponential fit. States
+//'   never left in the data are estimated as absorbing and have \code{NA}
+//'   parameters. The last sojourn in the data is censored and is not used.
+//' @seealso \code{\link{ctmcFit}}, \code{\link{rsmm}}, \code{\link{smmOccupancy}}
+//' 
+//' @examples
+//' data <- list(c("a", "b", "c", "a", "b", "a", "c", "b", "c"), c(0, 0.8, 2.1, 2.4, 4, 5, 5.9, 8.2, 9))
+//' smmFit(data)
+//' 
+//' @export
+//' 
+// [[Rcpp::export]]
+List smmFit(List data, String distribution = "weibull", bool perTransition = false) {
+  if (distribution != "weibull" && distribution != "gamma" &&
+      distribution != "exponential" && distribution != "empirical")
+    stop("distribution must be one among weibull, gamma, exponential and empirical");
+  
+  CharacterVector stateData = data[0];
+  NumericVector transData = data[1];
+  
+  if (stateData.size() != transData.size())
+    stop("The elements of data must have the same length");
+  
+  // Embedded jump chain from the transition counts
+  NumericMatrix counts = createSequenceMatrix(stateData, false, false);
+  CharacterVector sortedStates = rownames(counts);
+  int m = sortedStates.size();
+  NumericMatrix transMatr(m, m);
+  
+  for (int i = 0; i < m; ++i) {
+    double rowSum = 0;
+    
+    for (int j = 0; j < m; ++j)
+      rowSum += counts(i, j);
+    
+    for (int j = 0; j < m; ++j)
+      transMatr(i, j) = rowSum > 0 ? counts(i, j) / rowSum : (i == j ? 1 : 0);
+  }
+  
+  transMatr.attr("dimnames") = List::create(sortedStates, sortedStates);
+  
+  // Sojourns grouped by state, or by pair of states
+  unordered_map<string, int> stateToIndex;
+  
+  for (int i = 0; i < m; ++i)
+    stateToIndex[(string) sortedStates[i]] = i;
+  
+  int numGroups = perTransition ? m * m : m;
+  vector<vector<double>> sojourns(numGroups);
+  
+  for (int k = 0; k < stateData.size() - 1; ++k) {
+    int from = stateToIndex[(string) stateData[k]];
+    int to = stateToIndex[(string) stateData[k + 1]];
+    double sojourn = transData[k + 1] - transData[k];
+    
+    if (sojourn < 0)
+      stop("Transition times must be non decreasing");
+    
+    sojourns[perTransition ? from * m + to : from].push_back(sojourn);
+  }
+  
+  NumericMatrix parameters(numGroups, 2);
+  List observed(numGroups);
+  CharacterVector groupNames(numGroups);
+  
+  for (int g = 0; g < numGroups; ++g) {
+    vector<double>& x = sojourns[g];
+    groupNames[g] = perTransition ? 
+      (string) sortedStates[g / m] + "->" + (string) sortedStates[g % m] : 
+      (string) sortedStates[g];
+    observed[g] = NumericVector(x.begin(), x.end());
+    
+    if (x.empty()) {
+      parameters(g, 0) = NA_REAL;
+      parameters(g, 1) = NA_REAL;
+      continue;
+    }
+    
+    double mean = 0;
+    bool distinct = false;
+    
+    for (double sojourn : x) {
+      mean += sojourn / x.size();
+      distinct = distinct || sojourn != x[0];
+    }
+    
+    double shape = 1, scale = mean;
+    
+    if (distinct && (distribution == "weibull" || distribution == "gamma")) {
+      if (*std::min_element(x.begin(), x.end()) <= 0)
+        stop("Sojourn times must be positive to fit a %s distribution", distribution.get_cstring());
+      
+      if (distribution == "weibull")
+        fitWeibull(x, shape, scale);
+      else
+        fitGamma(x, shape, scale);
+    }
+    
+    if (distribution == "empirical") {
+      parameters(g, 0) = NA_REAL;
+      parameters(g, 1) = NA_REAL;
+    } else {
+      parameters(g, 0) = shape;
+      parameters(g, 1) = scale;
+    }
+  }
+  
+  parameters.attr("dimnames") = List::create(groupNames, CharacterVector::create("shape", "scale"));
+  observed.names() = groupNames;
+  
+  return List::create(_["states"] = sortedStates,
+                      _["transitionMatrix"] = transMatr,
+                      _["distribution"] = distribution,
+                      _["perTransition"] = perTransition,
+                      _["parameters"] = parameters,
+                      _["sojourns"] = observed);
+}
@@ -1,12 +1,22 @@
 #include <RcppArmadillo.h>
 // [[Rcpp::depends(RcppArmadillo)]]
+// [[Rcpp::depends(RcppParallel)]]
 #include <armadillo>
 #include <Rcpp.h>
+#include <RcppParallel.h>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
 using namespace Rcpp;
 using namespace RcppArmadillo;
+using namespace RcppParallel;
 using namespace arma;
 using namespace std;
 
+// Declared in utils.cpp
+vector<unsigned long long> pathSeeds(int paths);
 
 
 // [[Rcpp::export(.ExpectedTimeRCpp)]]
@@ -155,3 +165,735 @@ NumericVector impreciseProbabilityatTRCpp(S4 C, int i,int t, int s, double error
 }
 
 
+// Logarithm of a transition matrix, either through its eigendecomposition
+// (P = V D V^-1, log P = V log(D) V^-1) or through Armadillo's inverse
+// scaling and squaring algorithm with Pade approximants. Only the real
+// part is kept, as done by expm::logm
+bool transitionMatrixLog(const mat& P, bool useEigen, mat& result) {
+  if (useEigen) {
+    cx_vec eigval;
+    cx_mat eigvec, inverse;
+    
+    if (!eig_gen(eigval, eigvec, P) || !inv(inverse, eigvec))
+      return false;
+    
+    result = real(eigvec * diagmat(log(eigval)) * inverse);
+  } else {
+    cx_mat logarithm;
+    
+    if (!logmat(logarithm, P))
+      return false;
+    
+    result = real(logarithm);
+  }
+  
+  return result.is_finite();
+}
+
+// Diagonal adjustment (Israel, Rosenthal and Wei, 2001): negative 
+// off-diagonal entries are set to zero and the diagonal absorbs the 
+// difference, so rows sum to zero
+void diagonalAdjustment(mat& Q) {
+  int m = Q.n_rows;
+  
+  for (int i = 0; i < m; ++i) {
+    double offDiagonal = 0;
+    
+    for (int j = 0; j < m; ++j) {
+      if (i != j) {
+        Q(i, j) = max(Q(i, j), 0.0);
+        offDiagonal += Q(i, j);
+      }
+    }
+    
+    Q(i, i) = -offDiagonal;
+  }
+}
+
+// Weighted adjustment (Israel, Rosenthal and Wei, 2001): negative 
+// off-diagonal entries are set to zero and the row sum is redistributed
+// among all the entries proportionally to their absolute values
+void weightedAdjustment(mat& Q) {
+  int m = Q.n_rows;
+  
+  for (int i = 0; i < m; ++i) {
+    double rowSum = 0;
+    double absSum = 0;
+    
+    for (int j = 0; j < m; ++j) {
+      if (i != j)
+        Q(i, j) = max(Q(i, j), 0.0);
+      
+      rowSum += Q(i, j);
+      absSum += fabs(Q(i, j));
+    }
+    
+    if (absSum > 0)
+      for (int j = 0; j < m; ++j)
+        Q(i, j) -= fabs(Q(i, j)) * rowSum / absSum;
+  }
+}
+
+// Quasi-optimisation (Kreinin and Sidelnikova, 2001): each row is replaced
+// by its Euclidean projection on {x : sum(x) = 0, x_j >= 0 for j != i}.
+// The projection is x_j = max(a_j - mu, 0) off the diagonal and
+// x_i = a_i - mu, where mu is found scanning the off-diagonal entries
+// sorted decreasingly
+void quasiOptimisation(mat& Q) {
+  int m = Q.n_rows;
+  vector<double> offDiagonal(max(m - 1, 0));
+  
+  for (int i = 0; i < m; ++i) {
+    int k = 0;
+    
+    for (int j = 0; j < m; ++j)
+      if (j != i)
+        offDiagonal[k++] = Q(i, j);
+    
+    sort(offDiagonal.begin(), offDiagonal.end(), greater<double>());
+    
+    double partialSum = Q(i, i);
+    double mu = partialSum;
+    
+    for (k = 1; k < m; ++k) {
+      partialSum += offDiagonal[k - 1];
+      double candidate = partialSum / (k + 1);
+      
+      if (offDiagonal[k - 1] > candidate)
+        mu = candidate;
+    }
+    
+    for (int j = 0; j < m; ++j)
+      Q(i, j) = (i == j) ? Q(i, j) - mu : max(Q(i, j) - mu, 0.0);
+  }
+}
+
+enum GeneratorRegularisation { QUASI_OPTIMISATION, WEIGHTED_ADJUSTMENT, DIAGONAL_ADJUSTMENT };
+
+// Worker computing the regularised generator of each slice of a cube of
+// transition matrices in parallel
+struct GeneratorsFromTransitions : public Worker {
+  // each slice is a transition matrix (by rows)
+  const cube& transitions;
+  
+  // time elapsed for the transition matrices
+  const double t;
+  
+  const GeneratorRegularisation method;
+  const bool useEigen;
+  
+  // each slice is the regularised generator
+  cube& generators;
+  
+  // entry (i, k) is the Euclidean distance between the i-th row of the
+  // logarithm of the k-th matrix and the regularised row
+  mat& adjustment;
+  
+  // whether the logarithm of each matrix could be computed
+  vector<int>& failed;
+  
+  GeneratorsFromTransitions(const cube& transitions, double t, GeneratorRegularisation method,
+                            bool useEigen, cube& generators, mat& adjustment, vector<int>& failed) :
+    transitions(transitions), t(t), method(method), useEigen(useEigen),
+    generators(generators), adjustment(adjustment), failed(failed) {}
+  
+  void operator()(std::size_t begin, std::size_t end) {
+    for (std::size_t k = begin; k < end; ++k) {
+      mat logarithm;
+      
+      if (!transitionMatrixLog(transitions.slice(k), useEigen, logarithm)) {
+        failed[k] = true;
+        generators.slice(k).fill(datum::nan);
+        adjustment.col(k).fill(datum::nan);
+        continue;
+      }
+      
+      logarithm /= t;
+      mat Q = logarithm;
+      
+      if (method == QUASI_OPTIMISATION)
+        quasiOptimisation(Q);
+      else if (method == WEIGHTED_ADJUSTMENT)
+        weightedAdjustment(Q);
+      else
+        diagonalAdjustment(Q);
+      
+      generators.slice(k) = Q;
+      adjustment.col(k) = sqrt(sum(square(Q - logarithm), 1));
+    }
+  }
+};
+
+// [[Rcpp::export(.freq2GeneratorRcpp)]]
+List freq2GeneratorRcpp(NumericVector P, double t = 1, String method = "QO", String logmethod = "Eigen") {
+  IntegerVector dims = P.attr("dim");
+  
+  if ((dims.size() != 2 && dims.size() != 3) || dims[0] != dims[1])
+    stop("P must be a square matrix or an array of square matrices");
+  
+  if (t <= 0)
+    stop("t must be positive");
+  
+  GeneratorRegularisation regularisation;
+  
+  if (method == "QO")
+    regularisation = QUASI_OPTIMISATION;
+  else if (method == "WA")
+    regularisation = WEIGHTED_ADJUSTMENT;
+  else if (method == "DA")
+    regularisation = DIAGONAL_ADJUSTMENT;
+  else
+    stop("method must be one among \"QO\", \"WA\" and \"DA\"");
+  
+  bool useEigen = logmethod == "Eigen";
+  int m = dims[0];
+  int numMatrices = dims.size() == 3 ? dims[2] : 1;
+  
+  // Read only view over the memory of P
+  const cube transitions(P.begin(), m, m, numMatrices, false);
+  cube generators(m, m, numMatrices);
+  mat adjustment(m, numMatrices);
+  vector<int> failed(numMatrices, false);
+  
+  GeneratorsFromTransitions worker(transitions, t, regularisation, useEigen,
+                                   generators, adjustment, failed);
+  parallelFor(0, numMatrices, worker);
+  
+  int numFailed = count(failed.begin(), failed.end(), true);
+  
+  if (numFailed > 0)
+    warning("The logarithm of %d matrices could not be computed, NaN returned", numFailed);
+  
+  return List::create(_["generator"] = generators, _["adjustment"] = adjustment);
+}
+
+
+enum SojournDistribution { WEIBULL_SOJOURN, GAMMA_SOJOURN, EXPONENTIAL_SOJOURN, EMPIRICAL_SOJOURN };
+
+// Semi-Markov model as returned by smmFit
+struct SemiMarkovModel {
+  int m;
+  
+  // embedded jump chain, by rows
+  mat transitions;
+  
+  // whether sojourn laws are indexed by pair of states instead of by state
+  bool perTransition;
+  
+  SojournDistribution distribution;
+  vec shape;
+  vec scale;
+  
+  // sorted observed sojourns of each group. No observations means the
+  // state is never left
+  vector<vector<double>> sojourns;
+  
+  int group(int from, int to) const {
+    return perTransition ? from * m + to : from;
+  }
+};
+
+SemiMarkovModel semiMarkovModel(List model) {
+  SemiMarkovModel result;
+  NumericMatrix transitions = model["transitionMatrix"];
+  NumericMatrix parameters = model["parameters"];
+  List sojourns = model["sojourns"];
+  String distribution = model["distribution"];
+  
+  result.m = transitions.nrow();
+  result.transitions = as<mat>(transitions);
+  result.perTransition = as<bool>(model["perTransition"]);
+  
+  if (distribution == "weibull")
+    result.distribution = WEIBULL_SOJOURN;
+  else if (distribution == "gamma")
+    result.distribution = GAMMA_SOJOURN;
+  else if (distribution == "exponential")
+    result.distribution = EXPONENTIAL_SOJOURN;
+  else if (distribution == "empirical")
+    result.distribution = EMPIRICAL_SOJOURN;
+  else
+    stop("Unknown sojourn distribution, model must be fitted with smmFit");
+  
+  int numGroups = result.perTransition ? result.m * result.m : result.m;
+  
+  if (parameters.nrow() != numGroups || sojourns.size() != numGroups)
+    stop("model must be fitted with smmFit");
+  
+  result.shape = as<vec>(parameters(_, 0));
+  result.scale = as<vec>(parameters(_, 1));
+  
+  for (int g = 0; g < numGroups; ++g) {
+    vector<double> observed = as<vector<double>>(sojourns[g]);
+    sort(observed.begin(), observed.end());
+    result.sojourns.push_back(observed);
+  }
+  
+  return result;
+}
+
+// Probability that a sojourn of group g is at most x
+double sojournCdf(const SemiMarkovModel& model, int g, double x) {
+  const vector<double>& observed = model.sojourns[g];
+  
+  if (observed.empty())
+    return 0;
+  
+  switch (model.distribution) {
+    case WEIBULL_SOJOURN:
+      return R::pweibull(x, model.shape(g), model.scale(g), 1, 0);
+    case GAMMA_SOJOURN:
+      return R::pgamma(x, model.shape(g), model.scale(g), 1, 0);
+    case EXPONENTIAL_SOJOURN:
+      return 1 - exp(-x / model.scale(g));
+    default:
+      return (double) (upper_bound(observed.begin(), observed.end(), x) - observed.begin()) / observed.size();
+  }
+}
+
+// Draws a sojourn of group g. Only uses the given generator, so it can be
+// called from worker threads
+double sampleSojourn(const SemiMarkovModel& model, int g, mt19937_64& generator) {
+  const vector<double>& observed = model.sojourns[g];
+  
+  if (observed.empty())
+    return numeric_limits<double>::infinity();
+  
+  switch (model.distribution) {
+    case WEIBULL_SOJOURN:
+      return weibull_distribution<double>(model.shape(g), model.scale(g))(generator);
+    case GAMMA_SOJOURN:
+      return gamma_distribution<double>(model.shape(g), model.scale(g))(generator);
+    case EXPONENTIAL_SOJOURN:
+      return exponential_distribution<double>(1 / model.scale(g))(generator);
+    default:
+      return observed[uniform_int_distribution<size_t>(0, observed.size() - 1)(generator)];
+  }
+}
+
+// Worker simulating independent semi-Markov paths. Each path has its own
+// random generator, seeded from R, so results are reproducible with set.seed
+struct SemiMarkovPaths : public Worker {
+  const SemiMarkovModel& model;
+  const vector<int>& initialStates;
+  const vector<unsigned long long>& seeds;
+  
+  // maximum number of transitions and time horizon (ignored if not positive)
+  const int n;
+  const double T;
+  
+  vector<vector<int>>& states;
+  vector<vector<double>>& times;
+  
+  SemiMarkovPaths(const SemiMarkovModel& model, const vector<int>& initialStates,
+                  const vector<unsigned long long>& seeds, int n, double T,
+                  vector<vector<int>>& states, vector<vector<double>>& times) :
+    model(model), initialStates(initialStates), seeds(seeds), n(n), T(T),
+    states(states), times(times) {}
+  
+  void operator()(std::size_t begin, std::size_t end) {
+    uniform_real_distribution<double> uniform(0, 1);
+    
+    for (std::size_t p = begin; p < end; ++p) {
+      mt19937_64 generator(seeds[p]);
+      int state = initialStates[p];
+      double time = 0;
+      states[p].push_back(state);
+      times[p].push_back(time);
+      
+      for (int k = 0; k < n; ++k) {
+        // next state of the embedded chain
+        double u = uniform(generator);
+        double cumulative = 0;
+        int next = -1;
+        
+        for (int j = 0; j < model.m && (next == -1 || cumulative <= u); ++j) {
+          if (model.transitions(state, j) > 0) {
+            cumulative += model.transitions(state, j);
+            next = j;
+          }
+        }
+        
+        time += sampleSojourn(model, model.group(state, next), generator);
+        
+        if (!std::isfinite(time) || (T > 0 && time > T))
+          break;
+        
+        state = next;
+        states[p].push_back(state);
+        times[p].push_back(time);
+      }
+    }
+  }
+};
+
+//' @name rsmm
+//' @title Function to simulate a semi-Markov model
+//' @description Simulates paths of a semi-Markov model fitted with
+//'   \code{\link{smmFit}}. The paths are simulated in parallel
+//' @usage rsmm(n, model, t0 = character(), paths = 1L, T = 0)
+//' @param n Maximum number of transitions of each path.
+//' @param model A semi-Markov model as returned by \code{\link{smmFit}}.
+//' @param t0 Initial state of the paths, either a single state or one for each
+//'   path. By default it is sampled uniformly for each path.
+//' @param paths Number of paths to simulate.
+//' @param T If positive, each path is stopped at the last transition before
+//'   time T.
+//' @return A data frame with the \code{path} number, the \code{states} and
+//'   the \code{time} each state is entered.
+//' @seealso \code{\link{smmFit}}, \code{\link{rctmc}}
+//' 
+//' @examples
+//' data <- list(c("a", "b", "c", "a", "b", "a", "c", "b", "c"), c(0, 0.8, 2.1, 2.4, 4, 5, 5.9, 8.2, 9))
+//' model <- smmFit(data, distribution = "gamma")
+//' rsmm(10, model, t0 = "a", paths = 3)
+//' 
+//' @export
+//' 
+// [[Rcpp::export]]
+DataFrame rsmm(int n, List model, CharacterVector t0 = CharacterVector(), int paths = 1, double T = 0) {
+  SemiMarkovModel smm = semiMarkovModel(model);
+  CharacterVector states = model["states"];
+  
+  if (paths < 1)
+    stop("paths must be positive");
+  
+  if (t0.size() != 0 && t0.size() != 1 && t0.size() != paths)
+    stop("t0 must contain either one initial state or one for each path");
+  
+  vector<int> initialStates(paths);
+  
+  for (int p = 0; p < paths; ++p) {
+    if (t0.size() == 0) {
+      initialStates[p] = std::min((int) (unif_rand() * smm.m), smm.m - 1);
+    } else {
+      String initial = t0[t0.size() == 1 ? 0 : p];
+      int position = find(states.begin(), states.end(), initial) - states.begin();
+      
+      if (position == states.size())
+        stop("t0 must contain states of the model");
+      
+      initialStates[p] = position;
+    }
+  }
+  
+  vector<unsigned long long> seeds = pathSeeds(paths);
+  vector<vector<int>> pathStates(paths);
+  vector<vector<double>> pathTimes(paths);
+  SemiMarkovPaths worker(smm, initialStates, seeds, n, T, pathStates, pathTimes);
+  parallelFor(0, paths, worker);
+  
+  int total = 0;
+  
+  for (int p = 0; p < paths; ++p)
+    total += pathStates[p].size();
+  
+  IntegerVector pathColumn(total);
+  CharacterVector stateColumn(total);
+  NumericVector timeColumn(total);
+  int row = 0;
+  
+  for (int p = 0; p < paths; ++p) {
+    for (int k = 0; k < (int) pathStates[p].size(); ++k, ++row) {
+      pathColumn[row] = p + 1;
+      stateColumn[row] = states[pathStates[p][k]];
+      timeColumn[row] = pathTimes[p][k];
+    }
+  }
+  
+  return DataFrame::create(_["path"] = pathColumn, _["states"] = stateColumn,
+                           _["time"] = timeColumn, _["stringsAsFactors"] = false);
+}
+
+//' @name smmOccupancy
+//' @title Transient state occupancy of a semi-Markov model
+//' @description Computes the probability of being in each state over a
+//'   regular time grid, solving the Markov renewal equations of a model
+//'   fitted with \code{\link{smmFit}}
+//' @usage smmOccupancy(model, horizon, step, initialDistribution = numeric())
+//' @param model A semi-Markov model as returned by \code{\link{smmFit}}.
+//' @param horizon Last time of the grid.
+//' @param step Step of the grid. Sojourn times are discretised to multiples
+//'   of it, so smaller steps are more accurate.
+//' @param initialDistribution Distribution of the state entered at time 0.
+//'   Uniform by default.
+//' @return A matrix whose rows are the state distributions at times 0,
+//'   \code{step}, \code{2 * step}, ..., \code{horizon}.
+//' @details If \eqn{\nu_j(k)} is the probability of entering state j at step
+//'   k, then \eqn{\nu_j(k) = \sum_{l = 1}^k \sum_i \nu_i(k - l) p_{ij} f_{ij}(l)}
+//'   where \eqn{f_{ij}(l)} is the probability of leaving i after l steps, and
+//'   the occupancy is \eqn{\sum_{l = 0}^k \nu_j(k - l) S_j(l)}, with
+//'   \eqn{S_j(l)} the probability of staying in j more than l steps. The cost
+//'   is quadratic in the number of steps.
+//' @seealso \code{\link{smmFit}}, \code{\link{rsmm}}
+//' 
+//' @examples
+//' data <- list(c("a", "b", "c", "a", "b", "a", "c", "b", "c"), c(0, 0.8, 2.1, 2.4, 4, 5, 5.9, 8.2, 9))
+//' model <- smmFit(data)
+//' smmOccupancy(model, horizon = 5, step = 0.1, initialDistribution = c(1, 0, 0))
+//' 
+//' @export
+//' 
+// [[Rcpp::export]]
+NumericMatrix smmOccupancy(List model, double horizon, double step, 
+                           NumericVector initialDistribution = NumericVector()) {
+  SemiMarkovModel smm = semiMarkovModel(model);
+  CharacterVector states = model["states"];
+  int m = smm.m;
+  
+  if (!(step > 0) || horizon < 0)
+    stop("step must be positive and horizon non negative");
+  
+  vec initial(m);
+  
+  if (initialDistribution.size() == 0) {
+    initial.fill(1.0 / m);
+  } else if (initialDistribution.size() != m || std::abs(sum(initialDistribution) - 1) > 1e-5) {
+    stop("Provide a valid initial state probability distribution");
+  } else {
+    initial = as<vec>(initialDistribution);
+  }
+  
+  int K = (int) floor(horizon / step + 0.5);
+  
+  // kernel(i, j, l): probability of jumping from i to j after l steps
+  // survival(i, l): probability of staying in i more than l steps
+  cube kernel(m, m, K + 1, fill::zeros);
+  mat survival(m, K + 1, fill::ones);
+  
+  for (int i = 0; i < m; ++i) {
+    for (int j = 0; j < m; ++j) {
+      double p = smm.transitions(i, j);
+      
+      if (p == 0)
+        continue;
+      
+      int g = smm.group(i, j);
+      double previous = 0;
+      
+      for (int l = 1; l <= K; ++l) {
+        double current = sojournCdf(smm, g, l * step);
+        kernel(i, j, l) = p * (current - previous);
+        survival(i, l) -= p * current;
+        previous = current;
+      }
+    }
+  }
+  
+  // entrance probabilities
+  mat entrance(m, K + 1, fill::zeros);
+  entrance.col(0) = initial;
+  
+  for (int k = 1; k <= K; ++k) {
+    for (int l = 1; l <= k; ++l)
+      entrance.col(k) += kernel.slice(l).t() * entrance.col(k - l);
+    
+    if (k % 100 == 0)
+      R_CheckUserInterrupt();
+  }
+  
+  mat occupancy(K + 1, m, fill::zeros);
+  
+  for (int k = 0; k <= K; ++k)
+    for (int l = 0; l <= k; ++l)
+      occupancy.row(k) += (entrance.col(k - l) % survival.col(l)).t();
+  
+  NumericMatrix result = wrap(occupancy);
+  result.attr("dimnames") = List::create(R_NilValue, states);
+  
+  return result;
+}
+
+// Worker sampling CTMC paths conditioned on their endpoints through
+// uniformisation: the number of (possibly virtual) jumps is drawn first,
+// then the jump chain is sampled as a discrete bridge and the virtual
+// jumps are dropped
+struct UniformisedBridges : public Worker {
+  // uniformised jump chain I + Q / lambda, by rows
+  const mat& jumps;
+  
+  // column n is the probability of reaching the final state in n jumps
+  const mat& filter;
+  
+  // cumulative distribution of the number of jumps given the endpoints
+  const vector<double>& cumulative;
+  
+  const int from;
+  const double T;
+  const vector<unsigned long long>& seeds;
+  
+  vector<vector<int>>& states;
+  vector<vector<double>>& times;
+  
+  UniformisedBridges(const mat& jumps, const mat& filter, const vector<double>& cumulative,
+                     int from, double T, const vector<unsigned long long>& seeds,
+                     vector<vector<int>>& states, vector<vector<double>>& times) :
+    jumps(jumps), filter(filter), cumulative(cumulative), from(from), T(T), seeds(seeds),
+    states(states), times(times) {}
+  
+  void operator()(std::size_t begin, std::size_t end) {
+    uniform_real_distribution<double> uniform(0, 1);
+    int m = jumps.n_rows;
+    
+    for (std::size_t p = begin; p < end; ++p) {
+      mt19937_64 generator(seeds[p]);
+      double u = uniform(generator) * cumulative.back();
+      int n = upper_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin();
+      n = std::min(n, (int) cumulative.size() - 1);
+      
+      // jump times are uniform order statistics on [0, T]
+      vector<double> jumpTimes(n);
+      
+      for (int k = 0; k < n; ++k)
+        jumpTimes[k] = uniform(generator) * T;
+      
+      sort(jumpTimes.begin(), jumpTimes.end());
+      
+      int state = from;
+      states[p].push_back(state);
+      times[p].push_back(0);
+      
+      for (int k = 0; k < n; ++k) {
+        int remaining = n - k - 1;
+        double total = 0;
+        
+        for (int j = 0; j < m; ++j)
+          total += jumps(state, j) * filter(j, remaining);
+        
+        double target = uniform(generator) * total;
+        double partial = 0;
+        int next = -1;
+        
+        for (int j = 0; j < m && (next == -1 || partial <= target); ++j) {
+          double weight = jumps(state, j) * filter(j, remaining);
+          
+          if (weight > 0) {
+            partial += weight;
+            next = j;
+          }
+        }
+        
+        if (next != state) {
+          states[p].push_back(next);
+          times[p].push_back(jumpTimes[k]);
+        }
+        
+        state = next;
+      }
+    }
+  }
+};
+
+//' @name ctmcBridge
+//' @title Function to simulate CTMC paths conditioned on their endpoints
+//' @description Simulates exactly, without rejection, paths of a CTMC that
+//'   start in a given state and are in another given state at time T
+//' @usage ctmcBridge(ctmc, from, to, T, paths = 1L)
+//' @param ctmc The CTMC S4 object.
+//' @param from Initial state of the paths.
+//' @param to State of the paths at time T.
+//' @param T Time at which the paths must be in state \code{to}.
+//' @param paths Number of paths to simulate.
+//' @return A data frame with the \code{path} number, the \code{states} and
+//'   the \code{time} each state is entered. The last state of each path is
+//'   \code{to}.
+//' @details The generator is uniformised with rate \eqn{\lambda = \max_i |q_{ii}|}.
+//'   The number of jumps is drawn from its distribution given the
+//'   endpoints, the jump times are uniform order statistics and the states
+//'   are drawn from the uniformised chain reweighted by the probabilities
+//'   \eqn{(I + Q / \lambda)^k_{\cdot, to}}, which are computed once for all
+//'   paths. Paths are simulated in parallel.
+//' @references Hobolth, A. and Stone, E. A. (2009). Simulation from endpoint-conditioned,
+//'   continuous-time Markov chains on a finite state space, with applications to
+//'   molecular evolution. The Annals of Applied Statistics, 3(3), 1204-1231.
+//' @seealso \code{\link{rctmc}}, \code{\link{markovchainBridge}}
+//' 
+//' @examples
+//' energyStates <- c("sigma", "sigma_star")
+//' gen <- matrix(data = c(-3, 3, 1, -1), nrow = 2, byrow = TRUE, 
+//'               dimnames = list(energyStates, energyStates))
+//' molecularCTMC <- new("ctmc", states = energyStates, 
+//'                      byrow = TRUE, generator = gen, 
+//'                      name = "Molecular Transition Model")
+//' ctmcBridge(molecularCTMC, "sigma", "sigma", T = 2, paths = 3)
+//' 
+//' @export
+//' 
+// [[Rcpp::export]]
+DataFrame ctmcBridge(S4 ctmc, String from, String to, double T, int paths = 1) {
+  CharacterVector states = ctmc.slot("states");
+  mat Q = as<mat>(ctmc.slot("generator"));
+  bool byrow = ctmc.slot("byrow");
+  int m = states.size();
+  
+  if (!byrow)
+    Q = Q.t();
+  
+  int fromIndex = find(states.begin(), states.end(), from) - states.begin();
+  int toIndex = find(states.begin(), states.end(), to) - states.begin();
+  
+  if (fromIndex == m || toIndex == m)
+    stop("from and to must be states of the ctmc");
+  
+  if (!(T > 0) || paths < 1)
+    stop("T and paths must be positive");
+  
+  double lambda = 0;
+  
+  for (int i = 0; i < m; ++i)
+    lambda = std::max(lambda, std::abs(Q(i, i)));
+  
+  mat jumps = eye(m, m);
+  
+  if (lambda > 0)
+    jumps += Q / lambda;
+  
+  // Truncate the number of jumps where the Poisson tail is negligible
+  double mean = lambda * T;
+  int maxJumps = (int) ceil(mean + 10 * sqrt(mean) + 10);
+  mat filter(m, maxJumps + 1);
+  filter.col(0).zeros();
+  filter(toIndex, 0) = 1;
+  
+  for (int n = 1; n <= maxJumps; ++n)
+    filter.col(n) = jumps * filter.col(n - 1);
+  
+  vector<double> cumulative(maxJumps + 1);
+  double total = 0;
+  
+  for (int n = 0; n <= maxJumps; ++n) {
+    double logPoisson = mean > 0 ? -mean + n * log(mean) - R::lgammafn(n + 1) : (n == 0 ? 0 : -datum::inf);
+    total += exp(logPoisson) * filter(fromIndex, n);
+    cumulative[n] = total;
+  }
+  
+  if (!(total > 0))
+    stop("State to can not be reached from state from");
+  
+  vector<unsigned long long> seeds = pathSeeds(paths);
+  vector<vector<int>> pathStates(paths);
+  vector<vector<double>> pathTimes(paths);
+  UniformisedBridges worker(jumps, filter, cumulative, fromIndex, T, seeds, pathStates, pathTimes);
+  parallelFor(0, paths, worker);
+  
+  int rows = 0;
+  
+  for (int p = 0; p < paths; ++p)
+    rows += pathStates[p].size();
+  
+  IntegerVector pathColumn(rows);
+  CharacterVector stateColumn(rows);
+  NumericVector timeColumn(rows);
+  int row = 0;
+  
+  for (int p = 0; p < paths; ++p) {
+    for (int k = 0; k < (int) pathStates[p].size(); ++k, ++row) {
+      pathColumn[row] = p + 1;
+      stateColumn[row] = states[pathStates[p][k]];
+      timeColumn[row] = pathTimes[p][k];
+    }
+  }
+  
+  return DataFrame::create(_["path"] = pathColumn, _["states"] = stateColumn,
+                           _["time"] = timeColumn, _["stringsAsFactors"] = false);
+}
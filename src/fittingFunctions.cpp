@@ -16,6 +16,16 @@ using namespace std;
 #include "mapFitFunctions.h"
 #include <math.h>
 #include <armadillo>
+#include <random>
+
+// Declared in utils.cpp
+vector<unsigned long long> pathSeeds(int paths);
+
+// Declared in utils.cpp
+void syncForWorkers(const arma::sp_mat& matrix);
+
+// Defined in probabilistic.cpp
+arma::mat rewardsByDoubling(const arma::mat& A, const arma::mat& rewards, int n);
 
 // [[Rcpp::export(.markovchainSequenceRcpp)]]
 CharacterVector markovchainSequenceRcpp(int n, S4 markovchain, CharacterVector t0,
@@ -438,6 +448,138 @@ List markovchainSequenceParallelRcpp(S4 listObject, int n, bool include_t0 = fal
 }
 
 
+// Worker sampling paths of a markov chain conditioned on their endpoints.
+// The next state is drawn from the transition row reweighted by the
+// probability of reaching the final state in the remaining steps
+struct BridgeSampler : public Worker {
+  // transition matrix, by rows
+  const arma::mat& transitions;
+  
+  // column t is proportional to P^(n - t) e_to
+  const arma::mat& filter;
+  
+  const int from;
+  const vector<unsigned long long>& seeds;
+  
+  // row p holds the indexes of the states of the p-th path
+  arma::umat& paths;
+  
+  BridgeSampler(const arma::mat& transitions, const arma::mat& filter, int from,
+                const vector<unsigned long long>& seeds, arma::umat& paths) :
+    transitions(transitions), filter(filter), from(from), seeds(seeds), paths(paths) {}
+  
+  void operator()(std::size_t begin, std::size_t end) {
+    std::uniform_real_distribution<double> uniform(0, 1);
+    int m = transitions.n_rows;
+    int n = filter.n_cols - 1;
+    
+    for (std::size_t p = begin; p < end; ++p) {
+      std::mt19937_64 generator(seeds[p]);
+      int state = from;
+      paths(p, 0) = state;
+      
+      for (int t = 0; t < n; ++t) {
+        double total = 0;
+        
+        for (int j = 0; j < m; ++j)
+          total += transitions(state, j) * filter(j, t + 1);
+        
+        double target = uniform(generator) * total;
+        double partial = 0;
+        int next = -1;
+        
+        for (int j = 0; j < m && (next == -1 || partial <= target); ++j) {
+          double weight = transitions(state, j) * filter(j, t + 1);
+          
+          if (weight > 0) {
+            partial += weight;
+            next = j;
+          }
+        }
+        
+        state = next;
+        paths(p, t + 1) = state;
+      }
+    }
+  }
+};
+
+//' @name markovchainBridge
+//' @title Function to simulate markov chain paths conditioned on their endpoints
+//' @description Simulates exactly, without rejection, sequences of a markov
+//'   chain that start in a given state and are in another given state after
+//'   n steps
+//' @usage markovchainBridge(markovchain, from, to, n, paths = 1L)
+//' @param markovchain A \code{markovchain} object.
+//' @param from Initial state of the sequences.
+//' @param to State of the sequences after \code{n} steps.
+//' @param n Number of steps.
+//' @param paths Number of sequences to simulate.
+//' @return A character matrix with one sequence in each row. Its first
+//'   column is \code{from} and its last column is \code{to}.
+//' @details The probabilities \eqn{h_t = P^{n - t} e_{to}} of reaching
+//'   \code{to} in the remaining steps are computed once with \eqn{n}
+//'   matrix-vector products. Each step then samples from the transition row
+//'   reweighted by \eqn{h_{t + 1}}. Sequences are simulated in parallel.
+//' @seealso \code{\link{markovchainSequence}}, \code{\link{ctmcBridge}}
+//' 
+//' @examples
+//' statesNames <- c("a", "b", "c")
+//' mcB <- new("markovchain", states = statesNames, 
+//'    transitionMatrix = matrix(c(0.98, 0.01, 0.01, 0.02, 0.97, 0.01, 0, 0, 1), 
+//'    nrow = 3, byrow = TRUE, dimnames = list(statesNames, statesNames)))
+//' markovchainBridge(mcB, "a", "c", n = 10, paths = 5)
+//' 
+//' @export
+//' 
+// [[Rcpp::export]]
+CharacterMatrix markovchainBridge(S4 markovchain, String from, String to, int n, int paths = 1) {
+  CharacterVector states = markovchain.slot("states");
+  arma::mat transitions = as<arma::mat>(markovchain.slot("transitionMatrix"));
+  bool byrow = markovchain.slot("byrow");
+  int m = states.size();
+  
+  if (!byrow)
+    transitions = transitions.t();
+  
+  int fromIndex = std::find(states.begin(), states.end(), from) - states.begin();
+  int toIndex = std::find(states.begin(), states.end(), to) - states.begin();
+  
+  if (fromIndex == m || toIndex == m)
+    stop("from and to must be states of the markovchain");
+  
+  if (n < 0 || paths < 1)
+    stop("n must be non negative and paths positive");
+  
+  // Backward filter, rescaled at each step to avoid underflows
+  arma::mat filter(m, n + 1, arma::fill::zeros);
+  filter(toIndex, n) = 1;
+  
+  for (int t = n - 1; t >= 0; --t) {
+    filter.col(t) = transitions * filter.col(t + 1);
+    double scale = filter.col(t).max();
+    
+    if (scale > 0)
+      filter.col(t) /= scale;
+  }
+  
+  if (!(filter(fromIndex, 0) > 0))
+    stop("State to can not be reached from state from in n steps");
+  
+  vector<unsigned long long> seeds = pathSeeds(paths);
+  arma::umat indexes(paths, n + 1);
+  BridgeSampler worker(transitions, filter, fromIndex, seeds, indexes);
+  parallelFor(0, paths, worker);
+  
+  CharacterMatrix result(paths, n + 1);
+  
+  for (int p = 0; p < paths; ++p)
+    for (int t = 0; t <= n; ++t)
+      result(p, t) = states[indexes(p, t)];
+  
+  return result;
+}
+
 // convert a frequency matrix to a transition probability matrix
 NumericMatrix _toRowProbs(NumericMatrix x, bool sanitize = false) {
   int nrow = x.nrow(), ncol = x.ncol();
@@ -1676,33 +1818,84 @@ List markovchainFit(SEXP data, String method = "mle", bool byrow = true, int nbo
 }
 
           
+// Average occupation over steps 1, ..., N for a set of origins. Each origin
+// carries its distribution forward with one sparse product per step, the
+// origins being split among threads
+struct OccupationRows : public Worker {
+  const arma::sp_mat& transposed;
+  const vector<int>& origins;
+  const int N;
+  arma::mat& result;
+  
+  OccupationRows(const arma::sp_mat& transposed, const vector<int>& origins,
+                 int N, arma::mat& result)
+    : transposed(transposed), origins(origins), N(N), result(result) {}
+  
+  void operator()(size_t begin, size_t end) {
+    int noOfStates = transposed.n_rows;
+    
+    for (size_t o = begin; o < end; ++o) {
+      arma::vec distribution = arma::zeros(noOfStates);
+      arma::vec out = arma::zeros(noOfStates);
+      distribution(origins[o]) = 1;
+      
+      for (int p = 0; p < N; p++) {
+        distribution = transposed * distribution;
+        out += distribution;
+      }
+      
+      result.col(o) = out / N;
+    }
+  }
+};
+
+// Rows of the N-step occupation matrix (P + P^2 + ... + P^N) / N for the
+// given origins (1-based). The partial sums are doubled on dense matrices
+// when that is cheaper than the per origin recursions
 // [[Rcpp::export(.noofVisitsDistRCpp)]]
-NumericVector noofVisitsDistRCpp(NumericMatrix matrix, int i,int N) {
-    
+NumericMatrix noofVisitsDistRCpp(NumericMatrix matrix, bool byrow, 
+                                 IntegerVector origins, int N) {
+  
   // no of states in the process
   int noOfStates = matrix.ncol();
-  arma::vec out = arma::zeros(noOfStates);
+  int noOfOrigins = origins.size();
   arma::mat Tmatrix = as<arma::mat>(matrix);
-  arma::mat temp = Tmatrix;
+  vector<int> rows;
+  
+  if (!byrow)
+    Tmatrix = Tmatrix.t();
+  
+  for (int i : origins) {
+    if (i < 1 || i > noOfStates)
+      stop("please provide a valid inital state");
     
-  // initial distribution is in the transition matrix itself
-  for (int j = 0; j < noOfStates; j++)
-    out[j] = Tmatrix(i - 1, j);
+    rows.push_back(i - 1);
+  }
+  
+  arma::sp_mat transposed(Tmatrix.t());
+  double recursionCost = (double) N * noOfOrigins * transposed.n_nonzero;
+  double doublingCost = 2 * std::log2((double) N) * std::pow((double) noOfStates, 3);
+  arma::mat out;
+  
+  if (doublingCost < recursionCost) {
+    // (I + P + ... + P^{N - 1}) P
+    arma::mat sums = rewardsByDoubling(Tmatrix, Tmatrix, N - 1) / N;
+    out = sums.rows(arma::conv_to<arma::uvec>::from(rows));
+  } else {
+    arma::mat result(noOfStates, noOfOrigins);
+    OccupationRows occupation(transposed, rows, N, result);
     
-  //The distribution for Nth step is calculates after N multiplication of the transition matrix
-  // and adding everytime the coresponding ratios
-  // finally dividing by N
-  for (int p = 0; p < N - 1; p++) {
-      temp = temp * Tmatrix;
-      
-      for (int j = 0; j < noOfStates; j++)
-        out[j] += temp(i - 1, j);
+    syncForWorkers(transposed);
+    
+    if (noOfOrigins > 1)
+      parallelFor(0, noOfOrigins, occupation);
+    else
+      occupation(0, noOfOrigins);
+    
+    out = result.t();
   }
   
-  out = out/N;
-  NumericVector R = wrap(out);
-
-  return R;
+  return wrap(out);
 }
 
 #endif
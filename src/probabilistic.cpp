@@ -1,15 +1,23 @@
 // [[Rcpp::depends(RcppArmadillo)]]
+// [[Rcpp::depends(RcppParallel)]]
 
 #include <RcppArmadillo.h>
+#include <RcppParallel.h>
 #include <math.h>
 #include <unordered_set>
 #include <string>
 #include <algorithm>
 #include <stack>
+#include <stdint.h>
+#include <memory>
 
 using namespace Rcpp;
 using namespace std;
 using namespace arma;
+using namespace RcppParallel;
+
+// The RcppParallel workers of this file only call helpers that use no R
+// API, such as steadyStateErgodicMatrix and LUFactors::solve
 
 template <typename T>
 T sortByDimNames(const T m);
@@ -19,7 +27,7 @@ typedef unsigned int uint;
 
 // Returns whether a Markov chain is ergodic
 // Declared in this same file
-bool isIrreducible(S4 obj);
+bool isIrreducible(SEXP obj);
 
 // Declared in utils.cpp
 bool anyElement(const mat& matrix, bool (*condition)(const double&));
@@ -31,383 +39,1092 @@ bool allElements(const mat& matrix, bool (*condition)(const double&));
 bool approxEqual(const cx_double& a, const cx_double& b);
 
 
-// Used in commClassesKernel
-void strongConnect(int v, vector<int>& disc, vector<int>& low, vector<int>& onStack,
-                   int& index, stack<int>& exploring, NumericMatrix& P, 
-                   vector<unordered_set<int>>& components, int numStates) {
-  
-  disc[v] = index;
-  low[v] = index;
-  ++index;
-  exploring.push(v);
-  onStack[v] = true;
-  
-  // For each edge (v, w) that goes out of v
-  for (int w = 0; w < numStates; ++w) {
-    if (P(v, w) > 0) {
-      // If w has not been visited yet, compute [w], and update
-      // the minimum node we can travel to from v
-      if (disc[w] == -1) {
-        strongConnect(w, disc, low, onStack, index, exploring, P, components, numStates);
-        low[v] = min(low[v], low[w]);
-      // Otherwise, if w is on the stack of nodes been explored,
-      // update the minimum node we can travel to from v
-      } else if (onStack[w]) {
-        low[v] = min(low[v], disc[w]);
-      }
-      // Otherwise, (v, w) is a cross edge between components 
-      // in the DFS tree, do nothing
-    }
+// Declared in utils.cpp
+SEXP handlePointer(SEXP handle, const char* message);
+
+// Declared in utils.cpp
+void syncForWorkers(const sp_mat& matrix);
+
+// Declared in utils.cpp
+int stronglyConnectedComponents(const vector<int>& offsets, const vector<int>& targets,
+                                vector<int>& component, vector<bool>& closed);
+
+// Communicating classes of a Markov chain: the class of each state, with
+// the classes numbered by their smallest state, and whether each class 
+// is closed
+struct CommClasses {
+  vector<int> component;
+  vector<bool> closed;
+  int numClasses;
+  
+  bool isClosed(int state) const {
+    return closed[component[state]];
   }
+};
+
+// Adjacency lists of the states of a chain in compressed form: the
+// successors of state i are targets[offsets[i]], ..., targets[offsets[i + 1] - 1].
+// They are built once from the non-zero entries of P, walking it in memory order
+void adjacencyLists(const NumericMatrix& P, bool byrow, vector<int>& offsets, vector<int>& targets) {
+  int numStates = P.ncol();
+  offsets.assign(numStates + 1, 0);
+  targets.clear();
   
-  // If v is the root of [v], unwind the strongly connected 
-  // component from the stack
-  if (low[v] == disc[v]) {
-    bool remaining = true;
-    unordered_set<int> component;
-    int w;
-    
-    while (remaining) {
-      w = exploring.top();
-      exploring.pop();
-      component.insert(w);
-      onStack[w] = false;
-      remaining = w != v;
+  // The successors of i are the non-zero entries of the i-th column
+  if (!byrow) {
+    for (int i = 0; i < numStates; ++i) {
+      for (int j = 0; j < numStates; ++j)
+        if (P(j, i) > 0)
+          targets.push_back(j);
+      
+      offsets[i + 1] = targets.size();
     }
     
-    components.push_back(component);
+    return;
   }
+  
+  // Count the successors of each state first
+  for (int j = 0; j < numStates; ++j)
+    for (int i = 0; i < numStates; ++i)
+      if (P(i, j) > 0)
+        ++offsets[i + 1];
+  
+  for (int i = 0; i < numStates; ++i)
+    offsets[i + 1] += offsets[i];
+  
+  targets.resize(offsets[numStates]);
+  vector<int> next(offsets.begin(), offsets.end() - 1);
+  
+  for (int j = 0; j < numStates; ++j)
+    for (int i = 0; i < numStates; ++i)
+      if (P(i, j) > 0)
+        targets[next[i]++] = j;
 }
 
 // This method is based on Tarjan's algorithm to find strongly 
 // connected components in a directed graph: 
 // https://en.wikipedia.org/wiki/Tarjan's_strongly_connected_components_algorithm
-// to compute the communicating classes.
+// to compute the communicating classes. The search uses an explicit stack,
+// so it is O(m + non-zeros) and long transient paths can not overflow the
+// C stack
+CommClasses commClassesKernel(const vector<int>& offsets, const vector<int>& targets) {
+  CommClasses result;
+  result.numClasses = stronglyConnectedComponents(offsets, targets, result.component, result.closed);
+  
+  return result;
+}
+
+// Same as above for a matrix P stochastic by rows
+CommClasses commClassesKernel(const NumericMatrix& P) {
+  vector<int> offsets, targets;
+  adjacencyLists(P, true, offsets, targets);
+  
+  return commClassesKernel(offsets, targets);
+}
+
+// Same as above for a sparse matrix, stochastic by rows
+CommClasses commClassesKernel(const sp_mat& P) {
+  int numStates = P.n_cols;
+  vector<int> offsets(numStates + 1, 0);
+  
+  for (auto it = P.begin(); it != P.end(); ++it)
+    if ((*it) > 0)
+      ++offsets[it.row() + 1];
+  
+  for (int i = 0; i < numStates; ++i)
+    offsets[i + 1] += offsets[i];
+  
+  vector<int> targets(offsets[numStates]);
+  vector<int> next(offsets.begin(), offsets.end() - 1);
+  
+  for (auto it = P.begin(); it != P.end(); ++it)
+    if ((*it) > 0)
+      targets[next[it.row()]++] = it.col();
+  
+  return commClassesKernel(offsets, targets);
+}
+
 // Output: 
-//      - classes: a matrix whose entry (i, j) is true iff i and 
-//                 j are in the same communicating class
-//      - closed: a vector whose i-th entry indicates whether the 
-//                 class [i] is closed
+//      - classes: a vector whose i-th entry is the (1-based) class of the
+//                 i-th state
+//      - closed: a vector whose k-th entry indicates whether the 
+//                 k-th class is closed
+// P can be either a matrix or a dgCMatrix, stochastic by rows
 //
 // [[Rcpp::export(.commClassesKernelRcpp)]]
-List commClassesKernel(NumericMatrix P) {
-  // The matrix must be stochastic by rows
-  int numStates = P.ncol();
-  vector<int> disc(numStates, -1);
-  vector<int> low(numStates, -1);
-  vector<int> onStack(numStates, false);
-  vector<unordered_set<int>> components;
-  stack<int> exploring;
-  int index = 0;
-  
-  // If the component [v] has not been computed yet
-  // (disc[v] == -1), compute it
-  for (int v  = 0; v < numStates; ++v) {
-     if (disc[v] == -1)
-       strongConnect(v, disc, low, onStack, index, exploring, P, components, numStates);
-  }  
-  
-  // Create the output data structures
-  CharacterVector stateNames = rownames(P);
-  LogicalMatrix classes(numStates, numStates);
-  classes.attr("dimnames") = P.attr("dimnames");
-  std::fill(classes.begin(), classes.end(), false);
-  LogicalVector closed(numStates);
-  closed.names() = stateNames;
-  
-  for (auto component : components) {
-    bool isClosed = true;
-    
-    // The class is closed iff there is no edge going out of the class
-    for (int i : component) {
-      for (int j = 0; j < numStates; ++j)
-        if (P(i, j) > 0 && component.count(j) == 0)
-          isClosed = false;
-    }
+List commClassesKernelRcpp(SEXP P) {
+  CommClasses commClasses;
+  CharacterVector stateNames;
+  
+  if (Rf_isMatrix(P)) {
+    NumericMatrix transitions(P);
+    commClasses = commClassesKernel(transitions);
+    
+    if (!Rf_isNull(transitions.attr("dimnames")))
+      stateNames = rownames(transitions);
+  } else if (Rf_inherits(P, "dgCMatrix")) {
+    commClasses = commClassesKernel(as<sp_mat>(P));
+  } else {
+    stop("P must be either a matrix or a dgCMatrix");
+  }
+  
+  IntegerVector classes(commClasses.component.begin(), commClasses.component.end());
+  classes = classes + 1;
+  
+  if (stateNames.size() == classes.size())
+    classes.names() = stateNames;
+  
+  LogicalVector closed(commClasses.closed.begin(), commClasses.closed.end());
+  
+  return List::create(_["classes"] = classes, _["closed"] = closed);
+}
+
+// Declared in this same file
+int gcd(int a, int b);
+
+// Periods of the communicating classes of a chain. Each class is explored
+// by a BFS from its smallest state, restricted to the edges inside the 
+// class; the period is the gcd of level(u) + 1 - level(v) over those edges.
+// O(V + E). Classes without inner edges (transient states without a loop) 
+// get period 0. For every state, cyclicClass holds level mod period, which 
+// numbers the cyclic subclasses of its class
+struct Periodicity {
+  vector<int> period;
+  vector<int> cyclicClass;
+};
+
+Periodicity periodicityKernel(const vector<int>& offsets, const vector<int>& targets,
+                              const CommClasses& commClasses) {
+  int numStates = commClasses.component.size();
+  const vector<int>& component = commClasses.component;
+  Periodicity result;
+  result.period.assign(commClasses.numClasses, 0);
+  vector<int> level(numStates, -1);
+  vector<int> queue;
+  queue.reserve(numStates);
+  
+  // Classes are numbered by their smallest state, so the first state seen
+  // of each class is where its BFS starts
+  for (int s = 0; s < numStates; ++s) {
+    if (level[s] != -1)
+      continue;
+    
+    int c = component[s];
+    int d = 0;
+    level[s] = 0;
+    queue.clear();
+    queue.push_back(s);
     
-    // Set the communicating matrix and whether it is closed or not
-    for (int i : component) {
-      closed(i) = isClosed;
+    for (size_t k = 0; k < queue.size(); ++k) {
+      int u = queue[k];
       
-      for (int j : component)
-        classes(i, j) = true;
+      for (int e = offsets[u]; e < offsets[u + 1]; ++e) {
+        int v = targets[e];
+        
+        if (component[v] != c)
+          continue;
+        
+        if (level[v] == -1) {
+          level[v] = level[u] + 1;
+          queue.push_back(v);
+        } else {
+          d = gcd(d, level[u] + 1 - level[v]);
+        }
+      }
     }
+    
+    result.period[c] = d;
   }
   
-  return List::create(_["classes"] = classes, _["closed"] = closed);
+  result.cyclicClass.resize(numStates);
+  
+  for (int s = 0; s < numStates; ++s) {
+    int d = result.period[component[s]];
+    result.cyclicClass[s] = d > 0 ? level[s] % d : 0;
+  }
+  
+  return result;
 }
 
-// Wrapper that computes the communicating states from the matrix generated by 
-// commClassesKernel (a matrix where an entry i,j is TRUE iff i and j are in the
-// same communicating class). It also needs the list of states names from the
-// Markov Chain
-List computeCommunicatingClasses(LogicalMatrix& commClasses, CharacterVector& states) {
-  int numStates = states.size();
-  vector<bool> computed(numStates, false);
-  List classesList;
+// Reachability index of a Markov chain. The communicating classes are
+// condensed into a DAG, whose transitive closure is stored as one bitset
+// per class, computed in reverse topological order. Memory is 
+// O(numClasses² / 64) words and queries are O(1)
+class ReachabilityIndex {
+  public:
+    ReachabilityIndex(const vector<int>& offsets, const vector<int>& targets,
+                      const CommClasses& commClasses) {
+      component = commClasses.component;
+      numClasses = commClasses.numClasses;
+      words = (numClasses + 63) / 64;
+      closure.assign((size_t) numClasses * words, 0);
+      
+      // Edges of the condensation, without duplicates
+      int numStates = component.size();
+      vector<vector<int>> members(numClasses);
+      vector<vector<int>> successors(numClasses);
+      vector<int> inDegree(numClasses, 0);
+      vector<int> lastSeen(numClasses, -1);
+      
+      for (int i = 0; i < numStates; ++i)
+        members[component[i]].push_back(i);
+      
+      for (int c = 0; c < numClasses; ++c) {
+        for (int i : members[c]) {
+          for (int k = offsets[i]; k < offsets[i + 1]; ++k) {
+            int d = component[targets[k]];
+            
+            if (d != c && lastSeen[d] != c) {
+              lastSeen[d] = c;
+              successors[c].push_back(d);
+              ++inDegree[d];
+            }
+          }
+        }
+      }
+      
+      // Topological order with Kahn's algorithm
+      vector<int> order;
+      order.reserve(numClasses);
+      
+      for (int c = 0; c < numClasses; ++c)
+        if (inDegree[c] == 0)
+          order.push_back(c);
+      
+      for (int k = 0; k < (int) order.size(); ++k)
+        for (int d : successors[order[k]])
+          if (--inDegree[d] == 0)
+            order.push_back(d);
+      
+      // Each class reaches itself and whatever its successors reach
+      for (int k = numClasses - 1; k >= 0; --k) {
+        int c = order[k];
+        uint64_t* row = &closure[(size_t) c * words];
+        row[c / 64] |= (uint64_t) 1 << (c % 64);
+        
+        for (int d : successors[c]) {
+          const uint64_t* other = &closure[(size_t) d * words];
+          
+          for (int w = 0; w < words; ++w)
+            row[w] |= other[w];
+        }
+      }
+    }
+    
+    // whether state j can be reached from state i
+    bool reachable(int i, int j) const {
+      int d = component[j];
+      
+      return (closure[(size_t) component[i] * words + d / 64] >> (d % 64)) & 1;
+    }
+    
+    // whether to[k] can be reached from from[k] for each k
+    vector<bool> reachable(const vector<int>& from, const vector<int>& to) const {
+      vector<bool> result(from.size());
+      
+      for (size_t k = 0; k < from.size(); ++k)
+        result[k] = reachable(from[k], to[k]);
+      
+      return result;
+    }
+    
+    int size() const {
+      return component.size();
+    }
+    
+  private:
+    vector<int> component;
+    int numClasses;
+    int words;
+    vector<uint64_t> closure;
+};
+
+// Indices of a vector<int> as an arma::uvec, for subsetting
+uvec toIndices(const vector<int>& indices) {
+  uvec result(indices.size());
+  
+  for (size_t k = 0; k < indices.size(); ++k)
+    result(k) = indices[k];
   
-  for (int i = 0; i < numStates; ++i) {
-    CharacterVector currentClass;
+  return result;
+}
+
+// LU factorisation P A = L U of a square matrix, kept to solve several
+// systems against the same coefficients
+struct LUFactors {
+  bool factorise(const mat& A) {
+    return lu(L, U, permutation, A);
+  }
+  
+  // Solves A X = B with the two triangular sweeps
+  mat solve(const mat& B) const {
+    return arma::solve(trimatu(U), arma::solve(trimatl(L), permutation * B));
+  }
+  
+  mat L, U, permutation;
+};
+
+// Eigendecomposition P = V diag(lambda) V^{-1} used to raise P to any power
+// in O(m^2) once computed. It is only usable when P is diagonalisable with
+// well conditioned eigenvectors
+struct SpectralPowers {
+  SpectralPowers(const mat& probs) {
+    usable = eig_gen(values, vectors, probs) && rcond(vectors) > 1e-8 && 
+             inv(inverse, vectors);
+    
+    // The decomposition must give back the matrix
+    if (usable)
+      usable = abs(real(vectors * diagmat(values) * inverse) - probs).max() < 1e-10;
+  }
+  
+  // x P^t, or P^t when x is empty. Rounding errors are clipped to the
+  // exact bounds: [0, 1] for P^t and, for a non negative x, [0, sum(x_i)]
+  // on its i-th row
+  mat apply(const mat& x, int t) const {
+    cx_vec powers(values.n_elem);
+    
+    for (uword k = 0; k < values.n_elem; ++k)
+      powers(k) = std::pow(values(k), t);
+    
+    if (x.n_elem == 0)
+      return clamp(real(vectors * diagmat(powers) * inverse), 0.0, 1.0);
+    
+    mat result = real((cx_mat(x, zeros<mat>(x.n_rows, x.n_cols)) * vectors) * 
+                      diagmat(powers) * inverse);
+    
+    if (x.min() >= 0) {
+      vec bounds = sum(x, 1);
+      
+      for (uword i = 0; i < result.n_rows; ++i)
+        result.row(i) = clamp(rowvec(result.row(i)), 0.0, bounds(i));
+    }
     
-    if (!computed[i]) {
-      for (int j = 0; j < numStates; ++j) {
-        if (commClasses(i, j)) {
-          currentClass.push_back(states[j]);
-          computed[j] = true;
+    return result;
+  }
+  
+  bool usable;
+  cx_vec values;
+  cx_mat vectors, inverse;
+};
+
+// Declared below
+bool steadyStateErgodicMatrix(const mat& submatrix, vec& result);
+
+// A markovchain compiled once for repeated analysis. It holds the transition
+// matrix stochastic by rows, its adjacency lists, the communicating classes,
+// the recurrent and transient states and the canonic order of the states.
+// Periods, reachability, the LU factorisation of I - Q (Q being the 
+// transient block), for irreducible chains the one of the fundamental
+// system I - P + 1 pi^T, and the squarings or eigendecomposition used for
+// the powers of P are computed on first use and cached, so a full analysis
+// of the chain pays for each decomposition once
+class CompiledChain {
+  public:
+    CompiledChain(S4 object) {
+      NumericMatrix transitions = object.slot("transitionMatrix");
+      states = object.slot("states");
+      name = object.slot("name");
+      byrow = object.slot("byrow");
+      numStates = states.size();
+      probs = mat(transitions.begin(), numStates, numStates, true);
+      
+      for (int i = 0; i < numStates; ++i)
+        stateIndex[(string) states(i)] = i;
+      
+      if (!byrow)
+        probs = probs.t();
+      
+      adjacencyLists(transitions, byrow, offsets, targets);
+      commClasses = commClassesKernel(offsets, targets);
+      
+      // Canonic order: the recurrent classes one after the other, then
+      // the transient states
+      vector<vector<int>> members(commClasses.numClasses);
+      
+      for (int i = 0; i < numStates; ++i) {
+        members[commClasses.component[i]].push_back(i);
+        
+        if (commClasses.isClosed(i))
+          recurrent.push_back(i);
+        else
+          transient.push_back(i);
+      }
+      
+      for (int c = 0; c < commClasses.numClasses; ++c)
+        if (commClasses.closed[c])
+          canonicOrder.insert(canonicOrder.end(), members[c].begin(), members[c].end());
+      
+      canonicOrder.insert(canonicOrder.end(), transient.begin(), transient.end());
+      factorised = false;
+      fundamentalFactorised = false;
+    }
+    
+    const Periodicity& periodicity() {
+      if (!periods)
+        periods.reset(new Periodicity(periodicityKernel(offsets, targets, commClasses)));
+      
+      return *periods;
+    }
+    
+    const ReachabilityIndex& reachability() {
+      if (!index)
+        index.reset(new ReachabilityIndex(offsets, targets, commClasses));
+      
+      return *index;
+    }
+    
+    // Solves (I - Q) X = B, where Q is the transient block of the matrix
+    // and B has one row per transient state
+    mat solveTransient(const mat& B) {
+      if (!factorised) {
+        int n = transient.size();
+        uvec indices = toIndices(transient);
+        mat toFactorise = eye(n, n) - probs(indices, indices);
+        
+        if (!transientFactors.factorise(toFactorise))
+          stop("Could not factorise the transient block of the matrix");
+        
+        factorised = true;
+      }
+      
+      return transientFactors.solve(B);
+    }
+    
+    // Factorisation of Z^{-1} = I - P + 1 pi^T, where pi is the stationary
+    // distribution of the (irreducible) chain. Column j of Z gives the mean
+    // first passage times to the j-th state
+    const LUFactors& fundamental() {
+      if (!fundamentalFactorised) {
+        if (!steadyStateErgodicMatrix(probs, stationary))
+          stop("Failure computing eigen values / vectors for submatrix in steadyStateErgodicMatrix");
+        
+        mat toFactorise = eye(numStates, numStates) - probs;
+        
+        for (int j = 0; j < numStates; ++j)
+          toFactorise.col(j) += stationary(j);
+        
+        if (!fundamentalFactors.factorise(toFactorise))
+          stop("Problem factorising the fundamental matrix inside meanFirstPassageTime");
+        
+        fundamentalFactorised = true;
+      }
+      
+      return fundamentalFactors;
+    }
+    
+    // Stationary distribution used by the fundamental factorisation
+    const vec& stationaryDistribution() {
+      fundamental();
+      return stationary;
+    }
+    
+    // x P^t, or x = I when x is empty, multiplying by the squarings 
+    // P^(2^k) of the binary decomposition of t. The squarings are kept, so
+    // later calls only pay for the products
+    mat applyPower(const mat& x, int t) {
+      mat result = x.n_elem == 0 ? mat(eye(numStates, numStates)) : x;
+      
+      if (squares.empty())
+        squares.push_back(probs);
+      
+      for (int k = 0; t > 0; ++k, t >>= 1) {
+        if ((int) squares.size() <= k)
+          squares.push_back(squares[k - 1] * squares[k - 1]);
+        
+        if (t & 1)
+          result = result * squares[k];
+      }
+      
+      return result;
+    }
+    
+    // Eigendecomposition of the matrix, computed on first use
+    const SpectralPowers& spectral() {
+      if (!spectrum)
+        spectrum.reset(new SpectralPowers(probs));
+      
+      return *spectrum;
+    }
+    
+    // Names of the given states
+    CharacterVector statesAt(const vector<int>& indices) const {
+      CharacterVector result(indices.size());
+      
+      for (size_t k = 0; k < indices.size(); ++k)
+        result(k) = states(indices[k]);
+      
+      return result;
+    }
+    
+    // Indices of the given state names, failing with message if some name
+    // is not a state of the chain
+    vector<int> indicesOf(const CharacterVector& names, const char* message) const {
+      vector<int> result(names.size());
+      
+      for (int k = 0; k < names.size(); ++k) {
+        auto it = stateIndex.find((string) names(k));
+        
+        if (it == stateIndex.end())
+          stop(message);
+        
+        result[k] = it->second;
+      }
+      
+      return result;
+    }
+    
+    CharacterVector states;
+    CharacterVector name;
+    bool byrow;
+    int numStates;
+    unordered_map<string, int> stateIndex;
+    mat probs;
+    vector<int> offsets, targets;
+    CommClasses commClasses;
+    vector<int> recurrent, transient;
+    vector<int> canonicOrder;
+    
+  private:
+    unique_ptr<Periodicity> periods;
+    unique_ptr<ReachabilityIndex> index;
+    unique_ptr<SpectralPowers> spectrum;
+    vector<mat> squares;
+    bool factorised, fundamentalFactorised;
+    LUFactors transientFactors, fundamentalFactors;
+    vec stationary;
+};
+
+// The compiled chain behind obj, which is either a compiledMarkovchain or
+// a markovchain, compiled on the fly
+XPtr<CompiledChain> compiledChain(SEXP obj) {
+  if (Rf_inherits(obj, "compiledMarkovchain"))
+    return XPtr<CompiledChain>(handlePointer(obj, 
+      "The compiled chain is no longer valid, compile the markovchain again"));
+  
+  return XPtr<CompiledChain>(new CompiledChain(S4(obj)), true);
+}
+
+// [[Rcpp::export(.compileMarkovchainRcpp)]]
+SEXP compileMarkovchain(S4 object) {
+  return XPtr<CompiledChain>(new CompiledChain(object), true);
+}
+
+// Projects blocks of cohorts through the steps start + 1, start + 2, ...
+// Step s uses matrices[s - 1], or the last matrix past the end of the list,
+// so a homogeneous chain is a list of one matrix. Each block of rows is 
+// carried by its own thread and copied to the slices of the horizons
+struct CohortProjection : public Worker {
+  const vector<mat>& matrices;
+  const mat& initial;
+  const vector<int>& horizons;
+  const int start;
+  const size_t blockSize;
+  cube& result;
+  
+  CohortProjection(const vector<mat>& matrices, const mat& initial, 
+                   const vector<int>& horizons, int start, size_t blockSize,
+                   cube& result)
+    : matrices(matrices), initial(initial), horizons(horizons), start(start),
+      blockSize(blockSize), result(result) {}
+  
+  void operator()(size_t begin, size_t end) {
+    int last = matrices.size() - 1;
+    
+    for (size_t block = begin; block < end; ++block) {
+      uword firstRow = block * blockSize;
+      uword lastRow = std::min<uword>(firstRow + blockSize, initial.n_rows) - 1;
+      mat cohorts = initial.rows(firstRow, lastRow);
+      int at = 0;
+      
+      for (size_t h = 0; h < horizons.size(); ++h) {
+        for (; at < horizons[h]; ++at)
+          cohorts = cohorts * matrices[std::min(start + at, last)];
+        
+        result.slice(h).rows(firstRow, lastRow) = cohorts;
+      }
+    }
+  }
+};
+
+// Distributions of the cohorts (rows of initial) after each of the 
+// increasing horizons, counted from the step start, for the transition
+// matrices by rows of a homogeneous chain (a list of one matrix) or of a 
+// non homogeneous one. The result has one slice per horizon
+// [[Rcpp::export(.projectDistributionsRcpp)]]
+arma::cube projectDistributions(List matrices, NumericMatrix initial, 
+                                IntegerVector horizons, int start = 0) {
+  vector<mat> steps;
+  vector<int> at(horizons.begin(), horizons.end());
+  mat cohorts(initial.begin(), initial.nrow(), initial.ncol());
+  
+  for (int k = 0; k < matrices.size(); ++k) {
+    NumericMatrix step = matrices[k];
+    
+    if (step.nrow() != initial.ncol() || step.ncol() != initial.ncol())
+      stop("initial must have one column per state");
+    
+    steps.push_back(mat(step.begin(), step.nrow(), step.ncol()));
+  }
+  
+  if (steps.empty())
+    stop("At least one transition matrix is needed");
+  
+  for (size_t h = 0; h < at.size(); ++h)
+    if (at[h] < 0 || (h > 0 && at[h] < at[h - 1]))
+      stop("The horizons must be increasing non negative integers");
+  
+  size_t blockSize = 256;
+  size_t numBlocks = (cohorts.n_rows + blockSize - 1) / blockSize;
+  cube result(cohorts.n_rows, cohorts.n_cols, at.size());
+  CohortProjection projection(steps, cohorts, at, start, blockSize, result);
+  
+  if (numBlocks > 1)
+    parallelFor(0, numBlocks, projection);
+  else
+    projection(0, numBlocks);
+  
+  return result;
+}
+
+// Products of consecutive transition matrices of a markovchainList. Leaf k
+// is the matrix of the k-th chain by rows, its columns mapped to the states 
+// of the next chain (the last chain keeps its own states), so any range of
+// leaves can be multiplied. The states reachable in one step must belong to
+// the next chain, as checkSequenceRcpp validates. A segment tree of partial
+// products gives the product of any range with O(log L) matrix products
+class ProductIndex {
+  public:
+    ProductIndex(List chains) {
+      numSteps = chains.size();
+      
+      if (numSteps == 0)
+        stop("The markovchainList has no markovchains");
+      
+      for (int k = 0; k < numSteps; ++k) {
+        S4 chain = chains[k];
+        CharacterVector chainStates = chain.slot("states");
+        states.push_back(chainStates);
+        sizes.push_back(chainStates.size());
+      }
+      
+      for (int k = 0; k < numSteps; ++k) {
+        S4 chain = chains[k];
+        NumericMatrix transitions = chain.slot("transitionMatrix");
+        bool byrow = chain.slot("byrow");
+        int numStates = transitions.nrow();
+        mat probs(transitions.begin(), numStates, numStates);
+        
+        if (!byrow)
+          probs = probs.t();
+        
+        if (k == numSteps - 1) {
+          leaves.push_back(probs);
+          continue;
+        }
+        
+        const CharacterVector& next = states[k + 1];
+        unordered_map<string, int> position;
+        mat aligned(numStates, next.size(), fill::zeros);
+        
+        for (int j = 0; j < next.size(); ++j)
+          position[(string) next(j)] = j;
+        
+        for (int j = 0; j < numStates; ++j) {
+          if (accu(probs.col(j)) == 0)
+            continue;
+          
+          auto it = position.find((string) states[k](j));
+          
+          if (it == position.end())
+            stop("some states in the markovchain sequences are not contained in the following states");
+          
+          aligned.col(it->second) += probs.col(j);
         }
+        
+        leaves.push_back(aligned);
       }
       
-      classesList.push_back(currentClass);
+      tree.resize(4 * numSteps);
+      build(1, 0, numSteps);
+    }
+    
+    // Product of the leaves from, ..., to - 1, the identity when from == to
+    mat product(int from, int to) const {
+      mat result;
+      bool empty = true;
+      
+      if (from == to) {
+        int numStates = sizes[std::min(from, numSteps - 1)];
+        return eye(numStates, numStates);
+      }
+      
+      query(1, 0, numSteps, from, to, result, empty);
+      
+      return result;
+    }
+    
+    vector<CharacterVector> states;
+    vector<int> sizes;
+    int numSteps;
+    
+  private:
+    void build(int node, int lo, int hi) {
+      if (hi - lo == 1) {
+        tree[node] = leaves[lo];
+        return;
+      }
+      
+      int mid = (lo + hi) / 2;
+      build(2 * node, lo, mid);
+      build(2 * node + 1, mid, hi);
+      tree[node] = tree[2 * node] * tree[2 * node + 1];
+    }
+    
+    // Multiplies result, in order, by the nodes covering [from, to)
+    void query(int node, int lo, int hi, int from, int to, mat& result,
+               bool& empty) const {
+      if (to <= lo || hi <= from)
+        return;
+      
+      if (from <= lo && hi <= to) {
+        result = empty ? tree[node] : mat(result * tree[node]);
+        empty = false;
+        return;
+      }
+      
+      int mid = (lo + hi) / 2;
+      query(2 * node, lo, mid, from, to, result, empty);
+      query(2 * node + 1, mid, hi, from, to, result, empty);
+    }
+    
+    vector<mat> leaves;
+    vector<mat> tree;
+};
+
+// Answers a batch of interval queries on the index, in parallel
+struct IntervalProducts : public Worker {
+  const ProductIndex& index;
+  const vector<int>& from;
+  const vector<int>& to;
+  vector<mat>& results;
+  
+  IntervalProducts(const ProductIndex& index, const vector<int>& from, 
+                   const vector<int>& to, vector<mat>& results)
+    : index(index), from(from), to(to), results(results) {}
+  
+  void operator()(size_t begin, size_t end) {
+    for (size_t k = begin; k < end; ++k)
+      results[k] = index.product(from[k], to[k]);
+  }
+};
+
+// The product index behind obj, which is either a markovchainListIndex or
+// a markovchainList, indexed on the fly
+XPtr<ProductIndex> productIndex(SEXP obj) {
+  if (Rf_inherits(obj, "markovchainListIndex"))
+    return XPtr<ProductIndex>(handlePointer(obj, 
+      "The index is no longer valid, index the markovchainList again"));
+  
+  S4 object(obj);
+  List chains = object.slot("markovchains");
+  
+  return XPtr<ProductIndex>(new ProductIndex(chains), true);
+}
+
+// [[Rcpp::export(.markovchainListIndexRcpp)]]
+SEXP markovchainListIndex(S4 object) {
+  List chains = object.slot("markovchains");
+  
+  return XPtr<ProductIndex>(new ProductIndex(chains), true);
+}
+
+// Transition matrices from step from[k] to step to[k] (1-based, from[k] <= 
+// to[k] <= L + 1), that is the products of the chains from[k], ..., 
+// to[k] - 1
+// [[Rcpp::export(.intervalTransitionsRcpp)]]
+List intervalTransitions(SEXP obj, IntegerVector from, IntegerVector to) {
+  XPtr<ProductIndex> index = productIndex(obj);
+  int numQueries = from.size();
+  int numSteps = index->numSteps;
+  vector<int> starts, ends;
+  
+  if (to.size() != numQueries)
+    stop("from and to must have the same length");
+  
+  for (int k = 0; k < numQueries; ++k) {
+    if (from[k] < 1 || from[k] > to[k] || to[k] > numSteps + 1)
+      stop("Steps must satisfy 1 <= from <= to <= number of markovchains + 1");
+    
+    starts.push_back(from[k] - 1);
+    ends.push_back(to[k] - 1);
+  }
+  
+  vector<mat> products(numQueries);
+  IntervalProducts queries(*index, starts, ends, products);
+  
+  if (numQueries > 1)
+    parallelFor(0, numQueries, queries);
+  else
+    queries(0, numQueries);
+  
+  List result(numQueries);
+  
+  for (int k = 0; k < numQueries; ++k) {
+    NumericMatrix product = wrap(products[k]);
+    rownames(product) = index->states[std::min(starts[k], numSteps - 1)];
+    colnames(product) = index->states[std::min(ends[k], numSteps - 1)];
+    result[k] = product;
+  }
+  
+  return result;
+}
+
+// P^t, or x P^t for the rows x of initial when it has any, for each of the
+// horizons t. With method "squaring" the horizons are visited in increasing
+// order, moving from one to the next by the binary decomposition of their
+// difference. With "spectral" the eigendecomposition of P is used, and
+// "auto" takes it when it is well conditioned, falling back to squaring
+// [[Rcpp::export(.transitionPowersRcpp)]]
+List transitionPowers(SEXP obj, IntegerVector horizons, NumericMatrix initial,
+                      String method = "auto") {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  int numHorizons = horizons.size();
+  mat x(initial.begin(), initial.nrow(), initial.ncol());
+  List result(numHorizons);
+  
+  if (method != "auto" && method != "squaring" && method != "spectral")
+    stop("method must be one of auto, squaring or spectral");
+  
+  if (x.n_elem > 0 && (int) x.n_cols != chain->numStates)
+    stop("initial must have one column per state");
+  
+  for (int t : horizons)
+    if (t < 0 || t == NA_INTEGER)
+      stop("The powers must be non negative integers");
+  
+  bool spectral = method == "spectral";
+  
+  if (method == "auto")
+    spectral = chain->spectral().usable;
+  else if (spectral && !chain->spectral().usable)
+    stop("The matrix is not diagonalisable with well conditioned eigenvectors");
+  
+  vector<int> order(numHorizons);
+  
+  for (int k = 0; k < numHorizons; ++k)
+    order[k] = k;
+  
+  sort(order.begin(), order.end(), 
+       [&horizons](int a, int b) { return horizons[a] < horizons[b]; });
+  
+  mat current = x.n_elem == 0 ? mat(eye(chain->numStates, chain->numStates)) : x;
+  int at = 0;
+  
+  for (int k : order) {
+    mat power;
+    
+    if (spectral) {
+      power = chain->spectral().apply(x, horizons[k]);
+    } else {
+      current = chain->applyPower(current, horizons[k] - at);
+      at = horizons[k];
+      power = current;
     }
+    
+    // Powers of a matrix by columns are the transposed ones
+    if (!chain->byrow && x.n_elem == 0)
+      power = power.t();
+    
+    result[k] = power;
   }
   
+  return result;
+}
+
+// Groups the states by communicating class, keeping the classes whose closed
+// flag is in the given set. The classes are ordered by their smallest state
+List computeClasses(const CommClasses& commClasses, CharacterVector& states,
+                    bool includeClosed, bool includeOpen) {
+  vector<CharacterVector> classes(commClasses.numClasses);
+  List classesList;
+  
+  for (int i = 0; i < states.size(); ++i)
+    classes[commClasses.component[i]].push_back(states[i]);
+  
+  for (int k = 0; k < commClasses.numClasses; ++k)
+    if ((commClasses.closed[k] && includeClosed) || (!commClasses.closed[k] && includeOpen))
+      classesList.push_back(classes[k]);
+  
   return classesList;
 }
 
+// Wrapper that computes the communicating classes from the output of
+// commClassesKernel and the list of states names from the Markov Chain
+List computeCommunicatingClasses(const CommClasses& commClasses, CharacterVector& states) {
+  return computeClasses(commClasses, states, true, true);
+}
+
 // [[Rcpp::export(.communicatingClassesRcpp)]]
-List communicatingClasses(S4 object) {
+List communicatingClasses(SEXP object) {
   // Returns the underlying communicating classes
   // It is indifferent if the matrices are stochastic by rows or columns
-  NumericMatrix transitionMatrix = object.slot("transitionMatrix");
-  bool byrow = object.slot("byrow");
-  CharacterVector states = object.slot("states");
-  
-  if (!byrow)
-    transitionMatrix = transpose(transitionMatrix);
-  
-  List commClassesList = commClassesKernel(transitionMatrix);
-  LogicalMatrix commClasses = commClassesList["classes"];
+  XPtr<CompiledChain> chain = compiledChain(object);
   
-  return computeCommunicatingClasses(commClasses, states);
+  return computeCommunicatingClasses(chain->commClasses, chain->states);
 }
 
-// Wrapper that computes the transient states from a list of the states and a
-// vector indicating whether the communicating class for each state is closed
-CharacterVector computeTransientStates(CharacterVector& states, LogicalVector& closedClass) {
+// Wrapper that computes the transient states from a list of the states and
+// the communicating classes of the chain
+CharacterVector computeTransientStates(CharacterVector& states, const CommClasses& commClasses) {
   CharacterVector transientStates;
   
   for (int i = 0; i < states.size(); i++)
-    if (!closedClass[i])
+    if (!commClasses.isClosed(i))
       transientStates.push_back(states[i]);
     
   return transientStates;
 }
 
-// Wrapper that computes the recurrent states from a list of states and a
-// vector indicating whether the communicating class for each state is closed
-CharacterVector computeRecurrentStates(CharacterVector& states, LogicalVector& closedClass) {
+// Wrapper that computes the recurrent states from a list of states and
+// the communicating classes of the chain
+CharacterVector computeRecurrentStates(CharacterVector& states, const CommClasses& commClasses) {
   CharacterVector recurrentStates;
   
   for (int i = 0; i < states.size(); i++)
-    if (closedClass[i])
+    if (commClasses.isClosed(i))
       recurrentStates.push_back(states[i]);
     
   return recurrentStates;
 }
 
 // [[Rcpp::export(.transientStatesRcpp)]]
-CharacterVector transientStates(S4 object) {
-  NumericMatrix transitionMatrix = object.slot("transitionMatrix");
-  bool byrow = object.slot("byrow");
-  
-  if (!byrow)
-    transitionMatrix = transpose(transitionMatrix);
-  
-  List commKernel = commClassesKernel(transitionMatrix);
-  LogicalVector closed = commKernel["closed"];
-  CharacterVector states = object.slot("states");
+CharacterVector transientStates(SEXP object) {
+  XPtr<CompiledChain> chain = compiledChain(object);
 
-  return computeTransientStates(states, closed);
+  return computeTransientStates(chain->states, chain->commClasses);
 }
 
 // [[Rcpp::export(.recurrentStatesRcpp)]]
-CharacterVector recurrentStates(S4 object) {
-  NumericMatrix transitionMatrix = object.slot("transitionMatrix");
-  bool byrow = object.slot("byrow");
-  CharacterVector states = object.slot("states");
+CharacterVector recurrentStates(SEXP object) {
+  XPtr<CompiledChain> chain = compiledChain(object);
   
-  if (!byrow)
-    transitionMatrix = transpose(transitionMatrix);
-  
-  List commKernel = commClassesKernel(transitionMatrix);
-  LogicalVector closed = commKernel["closed"];
-  
-  return computeRecurrentStates(states, closed);
-}
-
-// Wrapper that computes the recurrent classes from the matrix given by 
-// commClassesKernel (which entry i,j is TRUE iff i and j are in the same
-// communicating class), a vector indicating wheter the class for state is
-// closed and the states of the Markov Chain
-List computeRecurrentClasses(LogicalMatrix& commClasses, 
-                             LogicalVector& closedClass, 
-                             CharacterVector& states) {
-  int numStates = states.size();
-  vector<bool> computed(numStates, false);
-  List recurrentClassesList;
-  bool isRecurrentClass;
-  
-  for (int i = 0; i < numStates; ++i) {
-    CharacterVector currentClass;
-    isRecurrentClass = closedClass(i) && !computed[i];
-    
-    if (isRecurrentClass) {
-      for (int j = 0; j < numStates; ++j) {
-        if (commClasses(i, j)) {
-          currentClass.push_back(states[j]);
-          computed[j] = true;
-        }
-      }
-      
-      recurrentClassesList.push_back(currentClass);
-    }
-  }
-  
-  return recurrentClassesList;
+  return computeRecurrentStates(chain->states, chain->commClasses);
+}
+
+// Wrapper that computes the recurrent classes from the output of 
+// commClassesKernel and the states of the Markov Chain
+List computeRecurrentClasses(const CommClasses& commClasses, CharacterVector& states) {
+  return computeClasses(commClasses, states, true, false);
 }
 
 // returns the recurrent classes
 // [[Rcpp::export(.recurrentClassesRcpp)]]
-List recurrentClasses(S4 object) {
-  NumericMatrix transitionMatrix = object.slot("transitionMatrix");
-  bool byrow = object.slot("byrow");
-  CharacterVector states = object.slot("states");
-  
-  if (!byrow)
-    transitionMatrix = transpose(transitionMatrix);
-  
-  List commClassesList = commClassesKernel(transitionMatrix);
-  LogicalMatrix commClasses = commClassesList["classes"];
-  LogicalVector closed = commClassesList["closed"];
-  
-  return computeRecurrentClasses(commClasses, closed, states);
-}
-
-// Wrapper that computes the transient classes from the matrix given by 
-// commClassesKernel (which entry i,j is TRUE iff i and j are in the same
-// communicating class), a vector indicating wheter the class for state is
-// closed and the states of the Markov Chain
-List computeTransientClasses(LogicalMatrix& commClasses, 
-                             LogicalVector& closedClass, 
-                             CharacterVector& states) {
-  int numStates = states.size();
-  vector<bool> computed(numStates, false);
-  List transientClassesList;
-  bool isTransientClass;
-  
-  for (int i = 0; i < numStates; ++i) {
-    CharacterVector currentClass;
-    isTransientClass = !closedClass(i) && !computed[i];
-    
-    if (isTransientClass) {
-      for (int j = 0; j < numStates; ++j) {
-        if (commClasses(i, j)) {
-          currentClass.push_back(states[j]);
-          computed[j] = true;
-        }
-      }
-      
-      transientClassesList.push_back(currentClass);
-    }
-  }
+List recurrentClasses(SEXP object) {
+  XPtr<CompiledChain> chain = compiledChain(object);
   
-  return transientClassesList;
+  return computeRecurrentClasses(chain->commClasses, chain->states);
+}
+
+// Wrapper that computes the transient classes from the output of 
+// commClassesKernel and the states of the Markov Chain
+List computeTransientClasses(const CommClasses& commClasses, CharacterVector& states) {
+  return computeClasses(commClasses, states, false, true);
 }
 
 // returns the transient classes
 // [[Rcpp::export(.transientClassesRcpp)]]
-List transientClasses(S4 object) {
-  NumericMatrix transitionMatrix = object.slot("transitionMatrix");
-  bool byrow = object.slot("byrow");
-  CharacterVector states = object.slot("states");
-  
-  if (!byrow)
-    transitionMatrix = transpose(transitionMatrix);
-  
-  List commClassesList = commClassesKernel(transitionMatrix);
-  LogicalMatrix commClasses = commClassesList["classes"];
-  LogicalVector closed = commClassesList["closed"];
+List transientClasses(SEXP object) {
+  XPtr<CompiledChain> chain = compiledChain(object);
   
-  return computeTransientClasses(commClasses, closed, states);
+  return computeTransientClasses(chain->commClasses, chain->states);
 }
 
 
-// Defined in probabilistic.cpp
-mat matrixPow(const mat& A, int n);
-
-
+// Entry (i, j) is TRUE iff j is reachable from i (j from i, when the chain 
+// is given by columns). The matrix is materialised from the index
 // [[Rcpp::export(.reachabilityMatrixRcpp)]]
-LogicalMatrix reachabilityMatrix(S4 obj) {
-  NumericMatrix matrix = obj.slot("transitionMatrix");
+LogicalMatrix reachabilityMatrix(SEXP obj) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  const ReachabilityIndex& index = chain->reachability();
+  bool byrow = chain->byrow;
+  int m = chain->numStates;
+  LogicalMatrix result(m, m);
+  
+  for (int j = 0; j < m; ++j)
+    for (int i = 0; i < m; ++i)
+      result(i, j) = byrow ? index.reachable(i, j) : index.reachable(j, i);
   
-  // Reachability matrix
-  int m = matrix.nrow();
-  mat X(matrix.begin(), m, m, true);
-  mat reachability = eye(m, m) + sign(X);
-  reachability = matrixPow(reachability, m - 1);
-  LogicalMatrix result = wrap(reachability > 0);
-  result.attr("dimnames") = matrix.attr("dimnames");
+  rownames(result) = chain->states;
+  colnames(result) = chain->states;
 
   return result;
 }
 
-// [[Rcpp::export(.isAccessibleRcpp)]]
-bool isAccessible(S4 obj, String from, String to) {
-  NumericMatrix probs = obj.slot("transitionMatrix");
-  CharacterVector states = obj.slot("states");
-  int fromPos = -1, toPos = -1;
-  bool byrow = obj.slot("byrow");
-  int m = probs.ncol();
-  
-  // Compute indices for states from and pos
-  for (int i = 0; i < m; ++i) {
-    if (states[i] == from)
-      fromPos = i;
-    if (states[i] == to)
-      toPos = i;
+// Batch reachability queries over state indexes (1-based)
+// [[Rcpp::export(.reachableRcpp)]]
+LogicalVector reachable(SEXP obj, IntegerVector from, IntegerVector to) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  int m = chain->numStates;
+  
+  if (from.size() != to.size())
+    stop("from and to must have the same length");
+  
+  vector<int> fromIdx(from.size()), toIdx(to.size());
+  
+  for (int k = 0; k < from.size(); ++k) {
+    if (from[k] < 1 || from[k] > m || to[k] < 1 || to[k] > m)
+      stop("State indexes out of range");
+    
+    fromIdx[k] = from[k] - 1;
+    toIdx[k] = to[k] - 1;
   }
   
-  if (fromPos == -1 || toPos == -1)
-    stop("Please give valid states method");
-  
-  stack<int> toExplore;
-  toExplore.push(fromPos);
-  vector<int> visited(m, false);
-  visited[fromPos] = true;
-  bool isReachable = false;
-  
-  // DFS until we hit 'to' state or we cannot traverse to more states
-  while (!toExplore.empty() && !isReachable) {
-    int i = toExplore.top();
-    toExplore.pop();
-    visited[i] = true;
-    isReachable = i == toPos;
-
-    for (int j = 0; j < m; ++j)
-      if (((byrow && !approxEqual(probs(i, j), 0)) || (!byrow && !approxEqual(probs(j, i), 0))) 
-          && !visited[j])
-        toExplore.push(j);
+  vector<bool> result = chain->reachability().reachable(fromIdx, toIdx);
+  
+  return LogicalVector(result.begin(), result.end());
+}
+
+// Whether each state to[k] is reachable from from[k]. The index is built
+// once, so each pair costs a name lookup plus an O(1) query. Vectors of 
+// length one are recycled
+// [[Rcpp::export(.isAccessibleRcpp)]]
+LogicalVector isAccessible(SEXP obj, CharacterVector from, CharacterVector to) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  const unordered_map<string, int>& stateIndex = chain->stateIndex;
+  int numFrom = from.size(), numTo = to.size();
+  int n = std::max(numFrom, numTo);
+  
+  if (numFrom == 0 || numTo == 0)
+    return LogicalVector(0);
+  
+  if (numFrom != numTo && numFrom != 1 && numTo != 1)
+    stop("from and to must have the same length");
+  
+  vector<int> fromIdx(n), toIdx(n);
+  
+  for (int k = 0; k < n; ++k) {
+    auto fromIt = stateIndex.find((string) from(numFrom == 1 ? 0 : k));
+    auto toIt = stateIndex.find((string) to(numTo == 1 ? 0 : k));
+    
+    if (fromIt == stateIndex.end() || toIt == stateIndex.end())
+      stop("Please give valid states method");
+    
+    fromIdx[k] = fromIt->second;
+    toIdx[k] = toIt->second;
   }
   
-  return isReachable;
+  vector<bool> result = chain->reachability().reachable(fromIdx, toIdx);
+  
+  return LogicalVector(result.begin(), result.end());
 }
 
 
 // summary of markovchain object
 // [[Rcpp::export(.summaryKernelRcpp)]]
-List summaryKernel(S4 object) {
-  NumericMatrix transitionMatrix = object.slot("transitionMatrix");
-  bool byrow = object.slot("byrow");
-  CharacterVector states = object.slot("states");
-  
-  if (!byrow)
-    transitionMatrix = transpose(transitionMatrix);
-  
-  List commClassesList = commClassesKernel(transitionMatrix);
-  LogicalMatrix commClasses = commClassesList["classes"];
-  LogicalVector closed = commClassesList["closed"];
-  List recurrentClasses = computeRecurrentClasses(commClasses, closed, states);
-  List transientClasses = computeTransientClasses(commClasses, closed, states);
+List summaryKernel(SEXP object) {
+  XPtr<CompiledChain> chain = compiledChain(object);
+  List recurrentClasses = computeRecurrentClasses(chain->commClasses, chain->states);
+  List transientClasses = computeTransientClasses(chain->commClasses, chain->states);
   
   List summaryResult = List::create(_["closedClasses"]    = recurrentClasses,
                                     _["recurrentClasses"] = recurrentClasses,
@@ -416,109 +1133,248 @@ List summaryKernel(S4 object) {
   return(summaryResult);
 }
 
-//here the kernel function to compute the first passage
-// [[Rcpp::export(.firstpassageKernelRcpp)]]
-NumericMatrix firstpassageKernel(NumericMatrix P, int i, int n) {
-  arma::mat G = as<arma::mat>(P);
-  arma::mat Pa = G;
-  arma::mat H(n, P.ncol()); 
+// First passage probabilities into each of the target sets. For a set A,
+// g_m(i) = P(T_A = m | X_0 = i) follows the taboo recursion
+// g_1 = P 1_A, g_{m + 1} = P (g_m restricted to the states out of A), so
+// each step is a sparse matrix-vector product that serves every origin at
+// once. The sets are processed in parallel, each one writing its own 
+// columns of the result: column o + numOrigins * s holds the passage
+// probabilities from origins[o] into sets[s], one row per step
+struct FirstPassageSets : public Worker {
+  const sp_mat& probs;
+  const vector<int>& origins;
+  const vector<vector<int>>& sets;
+  const int n;
+  mat& result;
+  
+  FirstPassageSets(const sp_mat& probs, const vector<int>& origins, 
+                   const vector<vector<int>>& sets, int n, mat& result)
+    : probs(probs), origins(origins), sets(sets), n(n), result(result) {}
+  
+  void operator()(size_t begin, size_t end) {
+    int numStates = probs.n_rows;
+    int numOrigins = origins.size();
+    
+    for (size_t s = begin; s < end; ++s) {
+      vec inSet(numStates, fill::zeros);
+      vec outOfSet(numStates, fill::ones);
+      
+      for (int state : sets[s]) {
+        inSet(state) = 1;
+        outOfSet(state) = 0;
+      }
+      
+      vec passage = probs * inSet;
+      
+      for (int step = 0; step < n; ++step) {
+        for (int o = 0; o < numOrigins; ++o)
+          result(step, o + numOrigins * s) = passage(origins[o]);
+        
+        passage = probs * (passage % outOfSet);
+      }
+    }
+  }
+};
+
+// First passage probabilities within 1, ..., n steps from each origin into
+// each of the target sets (1-based state indices). The cost is O(n nnz(P))
+// per set, whatever the number of origins
+// [[Rcpp::export(.firstPassageRcpp)]]
+NumericMatrix firstPassage(SEXP obj, IntegerVector origins, List sets, int n) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  int numStates = chain->numStates;
+  vector<int> originIndices;
+  vector<vector<int>> setIndices;
+  
+  for (int origin : origins) {
+    if (origin < 1 || origin > numStates)
+      stop("please provide a valid initial state");
+    
+    originIndices.push_back(origin - 1);
+  }
+  
+  for (int s = 0; s < sets.size(); ++s) {
+    IntegerVector set = sets[s];
+    vector<int> indices;
+    
+    for (int state : set) {
+      if (state < 1 || state > numStates)
+        stop("please provide proper set of states");
+      
+      indices.push_back(state - 1);
+    }
+    
+    setIndices.push_back(indices);
+  }
+  
+  sp_mat probs(chain->probs);
+  mat result(std::max(n, 0), originIndices.size() * setIndices.size());
+  FirstPassageSets passages(probs, originIndices, setIndices, n, result);
+  
+  syncForWorkers(probs);
+  
+  if (setIndices.size() > 1)
+    parallelFor(0, setIndices.size(), passages);
+  else
+    passages(0, setIndices.size());
+  
+  return wrap(result);
+}
+
+// Sum of (discount P)^t R for t = 0, ..., n by doubling the horizon: with
+// S_k = I + A + ... + A^{k - 1}, S_{2k} = S_k + A^k S_k and S_{k + 1} = 
+// I + A S_k. It takes O(m^3 log n) operations on dense matrices
+mat rewardsByDoubling(const mat& A, const mat& rewards, int n) {
+  int numStates = A.n_rows;
+  unsigned int horizon = n + 1;
+  int bit = 31;
+  mat sums = eye(numStates, numStates);
+  mat power = A;
+  
+  while (bit >= 0 && !(horizon & (1u << bit)))
+    --bit;
+  
+  // The leading bit gives S_1 = I, A^1 = A
+  for (--bit; bit >= 0; --bit) {
+    sums = sums + power * sums;
+    power = power * power;
+    
+    if (horizon & (1u << bit)) {
+      sums = A * sums;
+      sums.diag() += 1;
+      power = power * A;
+    }
+  }
+  
+  return sums * rewards;
+}
+
+// Expected rewards accumulated over n + 1 steps, v_n = r + discount P v_{n - 1}
+// with v_0 = r, for each column of rewards. Sparse matrix-matrix products
+// are used unless doubling the horizon on dense matrices is cheaper
+// [[Rcpp::export(.expectedRewardsRCpp)]]
+NumericMatrix expectedRewardsRCpp(SEXP obj, int n, NumericMatrix rewards, 
+                                  double discount = 1) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  int numStates = chain->numStates;
+  
+  if (rewards.nrow() != numStates)
+    stop("rewards must have one row per state");
+  
+  if (n < 0)
+    stop("n must be a non negative integer");
+  
+  mat r(rewards.begin(), numStates, rewards.ncol());
+  sp_mat P = discount * sp_mat(chain->probs);
+  mat values;
+  
+  double recursionCost = (double) n * P.n_nonzero * r.n_cols;
+  double doublingCost = 2 * std::log2(n + 1.0) * std::pow((double) numStates, 3);
+  
+  if (doublingCost < recursionCost) {
+    values = rewardsByDoubling(mat(P), r, n);
+  } else {
+    values = r;
+    
+    // v(n, u) = r + [P]v(n−1, u);
+    for (int i = 0; i < n; ++i)
+      values = r + P * values;
+  }
+  
+  return wrap(values);
+}
+
+// Expected discounted rewards over an infinite horizon, solving
+// (I - discount P) v = r once for all the columns of rewards
+// [[Rcpp::export(.discountedRewardsRCpp)]]
+NumericMatrix discountedRewardsRCpp(SEXP obj, NumericMatrix rewards, double discount) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  int numStates = chain->numStates;
+  
+  if (rewards.nrow() != numStates)
+    stop("rewards must have one row per state");
+  
+  if (discount < 0 || discount >= 1)
+    stop("discount must be in [0, 1) for an infinite horizon");
+  
+  mat r(rewards.begin(), numStates, rewards.ncol());
+  mat coeffs = eye(numStates, numStates) - discount * chain->probs;
+  mat values;
+  
+  if (!solve(values, coeffs, r))
+    stop("Error solving system in discountedRewards");
+  
+  return wrap(values);
+}
+
+// Long run average reward (gain) g = pi r and bias h of an irreducible chain,
+// h being the solution of (I - P + 1 pi^T) h = r - g, which reuses the
+// factorisation of the fundamental system
+// [[Rcpp::export(.averageRewardsRCpp)]]
+List averageRewardsRCpp(SEXP obj, NumericMatrix rewards) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  int numStates = chain->numStates;
+  
+  if (chain->commClasses.numClasses != 1)
+    stop("Markov chain needs to be ergodic (= irreducile) for this method to work");
+  
+  if (rewards.nrow() != numStates)
+    stop("rewards must have one row per state");
   
-  //here Thoralf suggestion
-  //initializing the first row
-  for (unsigned int j = 0; j < G.n_cols; j++)
-    H(0, j) = G(i-1, j);
+  mat r(rewards.begin(), numStates, rewards.ncol());
+  const LUFactors& factors = chain->fundamental();
+  rowvec gain = chain->stationaryDistribution().t() * r;
+  mat centered = r;
   
-  arma::mat E = 1 - arma::eye(P.ncol(), P.ncol());
-
-  for (int m = 1; m < n; m++) {
-    G = Pa * (G%E);
-    
-    for (unsigned int j = 0; j < G.n_cols; j ++) 
-      H(m, j) = G(i-1, j);
-  }
+  for (uword k = 0; k < r.n_cols; ++k)
+    centered.col(k) -= gain(k);
   
-  NumericMatrix R = wrap(H);
+  mat bias = factors.solve(centered);
   
-  return R;
+  return List::create(_["gain"] = NumericVector(gain.begin(), gain.end()),
+                      _["bias"] = bias);
 }
 
-
-
-// [[Rcpp::export(.firstPassageMultipleRCpp)]]
-NumericVector firstPassageMultipleRCpp(NumericMatrix P,int i, NumericVector setno, int n) {
-  arma::mat G = as<arma::mat>(P);
-  arma::mat Pa = G;
-  arma::vec H = arma::zeros(n); //here Thoralf suggestion
-  unsigned int size = setno.size();
-  //initializing the first row
-  for (unsigned int k = 0; k < size; k++) {
-    H[0] += G(i-1, setno[k]-1);
-  }
+// Expected rewards collected in steps 1, ..., n before hitting the set A
+// (1-based indices) when starting at s0, for each column of rewards. The
+// distribution over the states out of A is carried forward one sparse 
+// vector-matrix product per step
+// [[Rcpp::export(.expectedRewardsBeforeHittingARCpp)]]
+NumericVector expectedRewardsBeforeHittingARCpp(SEXP obj, IntegerVector A, int s0,
+                                                NumericMatrix rewards, int n) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  int numStates = chain->numStates;
   
-  arma::mat E = 1 - arma::eye(P.ncol(), P.ncol());
+  if (rewards.nrow() != numStates)
+    stop("rewards must have one row per state");
   
-  for (int m = 1; m < n; m++) {
-    G = Pa * (G%E);
-    
-    for (unsigned int k = 0; k < size; k++) {
-      H[m] += G(i-1, setno[k]-1);
-    }
-  }
+  if (s0 < 1 || s0 > numStates)
+    stop("please provide a valid initial state");
   
-  NumericVector R = wrap(H);
+  vec outOfA(numStates, fill::ones);
   
-  return R;
-}
-
-// [[Rcpp::export(.expectedRewardsRCpp)]]
-NumericVector expectedRewardsRCpp(NumericMatrix matrix, int n, NumericVector rewards) {
-  // initialises output vector
-  NumericVector out;
-  
-  // gets no of states
-  int no_of_states = matrix.ncol();
-  
-  // initialises armadillo matrices and vectors
-  arma::vec temp = arma::zeros(no_of_states);
-  arma::mat matr = as<arma::mat>(matrix);
-  arma::vec v = arma::zeros(no_of_states);
-  
-  // initialses the vector for the base case of dynamic programming expression
-  for (int i=0;i<no_of_states;i++) {
-    temp[i] = rewards[i];
-    v[i] = rewards[i];
+  for (int state : A) {
+    if (state < 1 || state > numStates)
+      stop("please provide proper set of states");
+    
+    outOfA(state - 1) = 0;
   }
   
-  // v(n, u) = r + [P]v(n−1, u);
-  for (int i=0;i<n;i++) {
-    temp = v + matr*temp;
-  }
+  if (outOfA(s0 - 1) == 0)
+    stop("the initial state must not belong to A");
   
-  // gets output in form of NumericVector
-  out = wrap(temp);
+  mat r(rewards.begin(), numStates, rewards.ncol());
+  sp_mat transposed(chain->probs.t());
+  vec distribution(numStates, fill::zeros);
+  rowvec result(r.n_cols, fill::zeros);
+  distribution(s0 - 1) = 1;
   
-  return out;
-}
-
-// [[Rcpp::export(.expectedRewardsBeforeHittingARCpp)]]
-double expectedRewardsBeforeHittingARCpp(NumericMatrix matrix,int s0,
-                               NumericVector rewards, int n ) {
-  float result = 0.0;
-  int size = rewards.size();
-  arma::mat matr = as<arma::mat>(matrix);
-  arma::mat temp = as<arma::mat>(matrix);
-  arma::vec r = as<arma::vec>(rewards);
-  arma::mat I = arma::zeros(1,size);
-  
-  I(0,s0-1) = 1;
-  
-  for (int j = 0; j < n; j++) {
-    arma::mat res = I*(temp*r);
-    result = result + res(0,0);
-    temp = temp*matr;
+  for (int step = 0; step < n; ++step) {
+    distribution = (transposed * distribution) % outOfA;
+    result += distribution.t() * r;
   }
   
-  return result;
+  return NumericVector(result.begin(), result.end());
 }
   
 
@@ -542,54 +1398,60 @@ int gcd (int a, int b) {
 //' 
 //' @export
 // [[Rcpp::export(period)]]
-int period(S4 object) {
-  bool irreducible = isIrreducible(object);
+int period(SEXP object) {
+  XPtr<CompiledChain> chain = compiledChain(object);
   
-  if (!irreducible) {
-    warning("The matrix is not irreducible");
+  if (chain->commClasses.numClasses != 1) {
+    warning("The matrix is not irreducible, use classPeriods for the period of each recurrent class");
     return 0;
-  } else {
-    NumericMatrix P = object.slot("transitionMatrix");
-    int n = P.ncol();
-    std::vector<double> r, T(1), w;
-    int d = 0, m = T.size(), i = 0, j = 0;
-    
-    if (n > 0) {
-      arma::vec v(n);
-      v[0] = 1;
-      
-      while (m>0 && d!=1) {
-        i = T[0];
-        T.erase(T.begin());
-        w.push_back(i);
-        j = 0;
-        
-        while (j < n) {
-          if (P(i,j) > 0) {
-            r.insert(r.end(), w.begin(), w.end());
-            r.insert(r.end(), T.begin(), T.end());
-            double k = 0;
-            
-            for (std::vector<double>::iterator it = r.begin(); it != r.end(); it ++) 
-              if (*it == j) k ++;
-            
-            if (k > 0) {
-               int b = v[i] + 1 - v[j];
-               d = gcd(d, b);
-            } else {
-              T.push_back(j);
-              v[j] = v[i] + 1;
-            }
-          }
-          j++;
-        }
-        m = T.size();
-      }
+  }
+  
+  return chain->periodicity().period[0];
+}
+
+//' @rdname structuralAnalysis
+//' 
+//' @export
+// [[Rcpp::export(classPeriods)]]
+List classPeriods(SEXP object) {
+  XPtr<CompiledChain> chain = compiledChain(object);
+  const CommClasses& commClasses = chain->commClasses;
+  const Periodicity& periodicity = chain->periodicity();
+  CharacterVector states = chain->states;
+  int numStates = chain->numStates;
+  
+  // Members of each class and of each of its cyclic subclasses, in state order
+  vector<vector<int>> members(commClasses.numClasses);
+  
+  for (int s = 0; s < numStates; ++s)
+    members[commClasses.component[s]].push_back(s);
+  
+  List result;
+  
+  for (int c = 0; c < commClasses.numClasses; ++c) {
+    if (!commClasses.closed[c])
+      continue;
+    
+    int d = periodicity.period[c];
+    CharacterVector classStates;
+    vector<CharacterVector> cyclic(d);
+    
+    for (int s : members[c]) {
+      classStates.push_back(states(s));
+      cyclic[periodicity.cyclicClass[s]].push_back(states(s));
     }
     
-    // v = v - floor(v/d)*d;
-    return d;
+    List cyclicClasses;
+    
+    for (int k = 0; k < d; ++k)
+      cyclicClasses.push_back(cyclic[k]);
+    
+    result.push_back(List::create(_["states"] = classStates,
+                                  _["period"] = d,
+                                  _["cyclicClasses"] = cyclicClasses));
   }
+  
+  return result;
 }
 
 //' @title predictiveDistribution
@@ -897,56 +1759,84 @@ NumericVector priorDistribution(NumericMatrix transMatr, NumericMatrix hyperpara
   return logProbVec;
 }
 
-// [[Rcpp::export(.hittingProbabilitiesRcpp)]]
-NumericMatrix hittingProbabilities(S4 object) {
-  NumericMatrix transitionMatrix = object.slot("transitionMatrix");
-  CharacterVector states = object.slot("states");
-  bool byrow = object.slot("byrow");
+// Hitting probabilities f(i, j) of the chain, stochastic by rows. From a
+// recurrent state, f(i, j) is 1 if j is in its class and 0 otherwise. From
+// the transient states, with N = (I - Q)^{-1} and Q the transient block:
+//   - f(i, j) = N(i, j) / N(j, j) for j transient, i != j, and 
+//     f(j, j) = 1 - 1 / N(j, j)
+//   - f(i, j) for j recurrent is the probability of being absorbed in the 
+//     class of j, X = N * P[transient, class of j] 1
+// so every column comes from the same factorisation of I - Q
+mat hittingProbabilitiesKernel(CompiledChain& chain) {
+  int numStates = chain.numStates;
+  const CommClasses& commClasses = chain.commClasses;
+  const vector<int>& transient = chain.transient;
+  int n = transient.size();
+  mat hittingProbs(numStates, numStates, fill::zeros);
+  vector<vector<int>> members(commClasses.numClasses);
+  vector<int> closedIndex(commClasses.numClasses, -1);
+  int numClosed = 0;
+  
+  for (int i : chain.recurrent)
+    members[commClasses.component[i]].push_back(i);
+  
+  for (int c = 0; c < commClasses.numClasses; ++c) {
+    if (commClasses.closed[c]) {
+      closedIndex[c] = numClosed++;
+      
+      for (int i : members[c])
+        for (int j : members[c])
+          hittingProbs(i, j) = 1;
+    }
+  }
   
-  if (!byrow)
-    transitionMatrix = transpose(transitionMatrix);
+  if (n == 0)
+    return hittingProbs;
   
-  int numStates = transitionMatrix.nrow();
-  arma::mat transitionProbs = as<arma::mat>(transitionMatrix);
-  arma::mat hittingProbs(numStates, numStates);
-  // Compute closed communicating classes
-  List commClasses = commClassesKernel(transitionMatrix);
-  List closedClass = commClasses["closed"];
-  LogicalMatrix communicating = commClasses["classes"];
-
+  // Right hand sides: the identity, whose solution is N, and the one-step
+  // probabilities of entering each closed class
+  mat rightPart(n, n + numClosed, fill::zeros);
   
-  for (int j = 0; j < numStates; ++j) {
-    arma::mat coeffs = as<arma::mat>(transitionMatrix);
-    arma::vec right_part = -transitionProbs.col(j);
+  for (int k = 0; k < n; ++k) {
+    int i = transient[k];
+    rightPart(k, k) = 1;
     
-    for (int i = 0; i < numStates; ++i) {
-      coeffs(i, j) = 0;
-      coeffs(i, i) -= 1;
-    }
-
-    for (int i = 0; i < numStates; ++i) {
-      if (closedClass(i)) {
-        for (int k = 0; k < numStates; ++k)
-          if (k != i)
-            coeffs(i, k) = 0;
-          else
-            coeffs(i, i) = 1;
-          
-        if (communicating(i, j))
-          right_part(i) = 1;
-        else
-          right_part(i) = 0;
-      }
+    for (int e = chain.offsets[i]; e < chain.offsets[i + 1]; ++e) {
+      int t = chain.targets[e];
+      
+      if (commClasses.isClosed(t))
+        rightPart(k, n + closedIndex[commClasses.component[t]]) += chain.probs(i, t);
     }
+  }
+  
+  mat solution = chain.solveTransient(rightPart);
+  
+  for (int b = 0; b < n; ++b) {
+    int j = transient[b];
+    double inverse = 1.0 / solution(b, b);
     
-    hittingProbs.col(j) = arma::solve(coeffs, right_part);
+    for (int a = 0; a < n; ++a)
+      hittingProbs(transient[a], j) = a == b ? 1 - inverse : solution(a, b) * inverse;
   }
   
-  NumericMatrix result = wrap(hittingProbs);
-  colnames(result) = states;
-  rownames(result) = states;
+  for (int j : chain.recurrent) {
+    int column = n + closedIndex[commClasses.component[j]];
+    
+    for (int a = 0; a < n; ++a)
+      hittingProbs(transient[a], j) = solution(a, column);
+  }
   
-  if (!byrow)
+  return hittingProbs;
+}
+
+// [[Rcpp::export(.hittingProbabilitiesRcpp)]]
+NumericMatrix hittingProbabilities(SEXP object) {
+  XPtr<CompiledChain> chain = compiledChain(object);
+  NumericMatrix result = wrap(hittingProbabilitiesKernel(*chain));
+  colnames(result) = chain->states;
+  rownames(result) = chain->states;
+  
+  if (!chain->byrow)
     result = transpose(result);
   
   return result;
@@ -956,100 +1846,61 @@ NumericMatrix hittingProbabilities(S4 object) {
 
 // method to convert into canonic form a markovchain object
 // [[Rcpp::export(.canonicFormRcpp)]]
-S4 canonicForm(S4 obj) {
-  NumericMatrix transitions = obj.slot("transitionMatrix");
-  bool byrow = obj.slot("byrow");
-  int numRows = transitions.nrow();
-  int numCols = transitions.ncol();
-  NumericMatrix resultTransitions(numRows, numCols);
-  CharacterVector states = obj.slot("states");
-  unordered_map<string, int> stateToIndex;
-  unordered_set<int> usedIndices;
-  int currentIndex;
-  List recClasses;
-  S4 input("markovchain");
+S4 canonicForm(SEXP obj) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  const vector<int>& indexPermutation = chain->canonicOrder;
+  int numStates = chain->numStates;
+  NumericMatrix resultTransitions(numStates, numStates);
+  CharacterVector newStates = chain->statesAt(indexPermutation);
   S4 result("markovchain");
-  vector<int> indexPermutation(numRows);
-  
-  if (!byrow) {
-    input.slot("transitionMatrix") = transpose(transitions);
-    input.slot("states") = states;
-    input.slot("byrow") = true;
-    transitions = transpose(transitions);
-  } else {
-    input = obj;
-  }
-  
-  recClasses = recurrentClasses(input);
-  
-  // Map each state to the index it has
-  for (int i = 0; i < states.size(); ++i) {
-    string state = (string) states[i];
-    stateToIndex[state] = i;
-  }
   
-  int toFill = 0;
-  for (CharacterVector recClass : recClasses) {
-    for (auto state : recClass) {
-      currentIndex = stateToIndex[(string) state];
-      indexPermutation[toFill] = currentIndex;
-      ++toFill;
-      usedIndices.insert(currentIndex);
-    }
-  }
-  
-  for (int i = 0; i < states.size(); ++i) {
-    if (usedIndices.count(i) == 0) {
-      indexPermutation[toFill] = i;
-      ++toFill;
-    }
-  }
-  
-  CharacterVector newStates(numRows);
-  
-  for (int i = 0; i < numRows; ++i) {
-    int r = indexPermutation[i];
-    newStates(i) = states(r);
+  for (int j = 0; j < numStates; ++j) {
+    int c = indexPermutation[j];
     
-    for (int j = 0; j < numCols; ++j) {
-      int c = indexPermutation[j];
-      resultTransitions(i, j) = transitions(r, c);
-    }
+    for (int i = 0; i < numStates; ++i)
+      resultTransitions(i, j) = chain->probs(indexPermutation[i], c);
   }
   
   rownames(resultTransitions) = newStates;
   colnames(resultTransitions) = newStates;
   
-  if (!byrow)
+  if (!chain->byrow)
     resultTransitions = transpose(resultTransitions);
   
   result.slot("transitionMatrix") = resultTransitions;
-  result.slot("byrow") = byrow;
+  result.slot("byrow") = chain->byrow;
   result.slot("states") = newStates;
-  result.slot("name") = input.slot("name");
+  result.slot("name") = chain->name;
   return result;
 }
 
 
-// Function to sort a matrix of vectors lexicographically
-NumericMatrix lexicographicalSort(NumericMatrix m) {
+// Function to sort a matrix of vectors lexicographically. order receives
+// the row of m placed at each row of the result
+NumericMatrix lexicographicalSort(NumericMatrix m, vector<int>& order) {
   int numCols = m.ncol();
   int numRows = m.nrow();
   
+  order.resize(numRows);
+  
+  for (int i = 0; i < numRows; ++i)
+    order[i] = i;
+  
   if (numRows > 0 && numCols > 0) {
-    vector<vector<double>> x(numRows, vector<double>(numCols));
-    
-    for (int i = 0; i < numRows; ++i)
+    // Sort the row indices, comparing the rows in place
+    sort(order.begin(), order.end(), [&m, numCols](int a, int b) {
       for (int j = 0; j < numCols; ++j)
-        x[i][j] = m(i,j);
-    
-    sort(x.begin(), x.end());
+        if (m(a, j) != m(b, j))
+          return m(a, j) < m(b, j);
+      
+      return false;
+    });
     
     NumericMatrix result(numRows, numCols);
     
-    for (int i = 0; i < numRows; ++i)
-      for (int j = 0; j < numCols; ++j)
-        result(i, j) = x[i][j];
+    for (int j = 0; j < numCols; ++j)
+      for (int i = 0; i < numRows; ++i)
+        result(i, j) = m(order[i], j);
     
     colnames(result) = colnames(m);
     return result;
@@ -1058,15 +1909,21 @@ NumericMatrix lexicographicalSort(NumericMatrix m) {
   }
 }
 
+NumericMatrix lexicographicalSort(NumericMatrix m) {
+  vector<int> order;
+  
+  return lexicographicalSort(m, order);
+}
+
 
 // This method computes the *unique* steady state that exists for an
 // matrix has to be schocastic by rows
-// ergodic (= irreducible) matrix
-vec steadyStateErgodicMatrix(const mat& submatrix) {
+// ergodic (= irreducible) matrix. Returns false if the system could not
+// be solved
+bool steadyStateErgodicMatrix(const mat& submatrix, vec& result) {
   int nRows = submatrix.n_rows;
   int nCols = submatrix.n_cols;
   vec rightPart(nRows + 1, fill::zeros);
-  vec result;
   mat coeffs(nRows + 1, nCols);
   
   // If P is Ergodic, the system (I - P)*w = 0 plus the equation 
@@ -1086,85 +1943,313 @@ vec steadyStateErgodicMatrix(const mat& submatrix) {
   
   rightPart(nRows) = 1;
   
-  if (!solve(result, coeffs, rightPart))
+  return solve(result, coeffs, rightPart);
+}
+
+// Same as above, failing when the system can not be solved
+vec steadyStateErgodicMatrix(const mat& submatrix) {
+  vec result;
+  
+  if (!steadyStateErgodicMatrix(submatrix, result))
     stop("Failure computing eigen values / vectors for submatrix in steadyStateErgodicMatrix");
   
   return result;
 }
 
-// Precondition: the matrix should be stochastic by rows
-NumericMatrix steadyStatesByRecurrentClasses(S4 object) {
-  List recClasses = recurrentClasses(object);
-  int numRecClasses = recClasses.size();
-  NumericMatrix transitionMatrix = object.slot("transitionMatrix");
-  
-  CharacterVector states = object.slot("states");
-  int numCols = transitionMatrix.ncol();
-  NumericMatrix steady(numRecClasses, numCols);
-  unordered_map<string, int> stateToIndex;
-  int steadyStateIndex = 0;
+// Options of the stationary distribution solvers. method is one of "auto",
+// "direct", "power", "gaussSeidel" or "sor"
+struct StationaryOptions {
+  string method;
+  double tolerance;
+  int maxit;
+  double omega;
+};
+
+// Diagnostics of the solve of a closed class
+struct StationarySolve {
+  vec pi;
+  string method;
+  int iterations;
+  double residual;
+  bool converged;
+};
+
+// 1-norm of pi P - pi over a closed class. P is stochastic by rows, so its
+// j-th column holds the transitions into j. position maps each state to its
+// index inside the class, or -1
+double stationaryResidual(const sp_mat& P, const uvec& members, 
+                          const vector<int>& position, const vec& pi) {
+  double residual = 0;
+  
+  for (uword j = 0; j < members.n_elem; ++j) {
+    double inflow = 0;
+    
+    for (auto it = P.begin_col(members(j)); it != P.end_col(members(j)); ++it)
+      if (position[it.row()] >= 0)
+        inflow += pi(position[it.row()]) * (*it);
+    
+    residual += std::abs(inflow - pi(j));
+  }
   
-  // Map each state to the index it has
-  for (int i = 0; i < states.size(); ++i) {
-    string state = (string) states[i];
-    stateToIndex[state] = i;
+  return residual;
+}
+
+// Stationary distribution of a closed class with sweeps over the sparse
+// incoming transitions:
+//   - power: iterates the lazy chain (I + P) / 2, which has the same 
+//     stationary distribution and also converges on periodic classes
+//   - gaussSeidel / sor: pi_j = (1 - omega) pi_j + omega * 
+//     sum_{i != j} pi_i P_ij / (1 - P_jj), with omega = 1 for Gauss-Seidel
+// Stops when no entry changes more than the tolerance
+void iterativeSteadyState(const sp_mat& P, const uvec& members, const vector<int>& position,
+                          const StationaryOptions& options, StationarySolve& solve) {
+  int k = members.n_elem;
+  bool power = solve.method == "power";
+  double omega = solve.method == "sor" ? options.omega : 1;
+  vec pi(k);
+  pi.fill(1.0 / k);
+  vec selfLoop(k, fill::zeros);
+  
+  for (int j = 0; j < k; ++j)
+    for (auto it = P.begin_col(members(j)); it != P.end_col(members(j)); ++it)
+      if (it.row() == members(j))
+        selfLoop(j) = (*it);
+  
+  solve.converged = false;
+  solve.iterations = 0;
+  
+  if (k == 1) {
+    solve.pi = vec(1, fill::ones);
+    solve.converged = true;
+    return;
   }
   
-  // For each recurrent class, there must be an steady state
-  for (CharacterVector recurrentClass : recClasses) {
-    int recClassSize = recurrentClass.size();
-    mat subMatrix(recClassSize, recClassSize);
+  while (solve.iterations < options.maxit && !solve.converged) {
+    vec previous = power ? pi : vec();
+    double change = 0;
     
-    // Fill the submatrix corresponding to the current steady class
-    // Note that for that we have to subset the matrix with the indices
-    // the states in the recurrent class ocuppied in the transition matrix
-    for (int i = 0; i < recClassSize; ++i) {
-      int r = stateToIndex[(string) recurrentClass[i]];
+    for (int j = 0; j < k; ++j) {
+      double inflow = 0;
       
-      for (int j = 0; j < recClassSize; ++j) {
-        int c = stateToIndex[(string) recurrentClass[j]];
-        subMatrix(i, j) = transitionMatrix(r, c);
-      }
+      for (auto it = P.begin_col(members(j)); it != P.end_col(members(j)); ++it)
+        if (position[it.row()] >= 0 && (power || (int) it.row() != (int) members(j)))
+          inflow += (power ? previous(position[it.row()]) : pi(position[it.row()])) * (*it);
+      
+      double updated = power ? 0.5 * (previous(j) + inflow) : 
+                               (1 - omega) * pi(j) + omega * inflow / (1 - selfLoop(j));
+      change = std::max(change, std::abs(updated - pi(j)));
+      pi(j) = updated;
     }
+    
+    pi /= accu(pi);
+    ++solve.iterations;
+    solve.converged = change <= options.tolerance;
+  }
+  
+  solve.pi = pi;
+}
 
-    // Compute the steady states for the given submatrix
-    vec steadyState = steadyStateErgodicMatrix(subMatrix);
-
-    for (int i = 0; i < recClassSize; ++i) {
-      int c = stateToIndex[(string) recurrentClass[i]];
-      steady(steadyStateIndex, c) = steadyState(i);;
+// Solves the stationary distribution of each closed class on a worker 
+// thread. Every class writes its own entries of the preallocated output. 
+// position holds the index of each recurrent state inside its class: the
+// transitions into a closed class only come from the class itself or from
+// transient states (position -1), so the map can be shared
+struct ClassSteadyStates : public Worker {
+  const sp_mat& P;
+  const vector<vector<uword>>& members;
+  const vector<int>& position;
+  const StationaryOptions& options;
+  int denseLimit;
+  
+  mat& result;
+  vector<StationarySolve>& solves;
+  vector<int>& failed;
+  
+  ClassSteadyStates(const sp_mat& P, const vector<vector<uword>>& members, 
+                    const vector<int>& position, const StationaryOptions& options,
+                    int denseLimit, mat& result, vector<StationarySolve>& solves,
+                    vector<int>& failed)
+    : P(P), members(members), position(position), options(options), 
+      denseLimit(denseLimit), result(result), solves(solves), failed(failed) {}
+  
+  void operator()(size_t begin, size_t end) {
+    for (size_t row = begin; row < end; ++row) {
+      uvec classMembers(members[row]);
+      int k = classMembers.n_elem;
+      StationarySolve& solve = solves[row];
+      solve.method = options.method;
+      
+      if (solve.method == "auto")
+        solve.method = k <= denseLimit ? "direct" : "gaussSeidel";
+      
+      if (solve.method == "direct") {
+        mat block(k, k, fill::zeros);
+        
+        for (int j = 0; j < k; ++j)
+          for (auto it = P.begin_col(classMembers(j)); it != P.end_col(classMembers(j)); ++it)
+            if (position[it.row()] >= 0)
+              block(position[it.row()], j) = (*it);
+        
+        if (!steadyStateErgodicMatrix(block, solve.pi)) {
+          failed[row] = true;
+          continue;
+        }
+        
+        solve.iterations = 0;
+        solve.converged = true;
+      } else {
+        iterativeSteadyState(P, classMembers, position, options, solve);
+      }
+      
+      solve.residual = stationaryResidual(P, classMembers, position, solve.pi);
+      
+      for (int i = 0; i < k; ++i)
+        result(row, classMembers(i)) = solve.pi(i);
     }
+  }
+};
+
+// Stationary distributions of every closed class of P, stochastic by rows,
+// one per row. Classes up to denseLimit states are solved with a dense
+// direct method with method = "auto", larger ones with Gauss-Seidel. The
+// classes are solved in parallel
+mat steadyStatesKernel(const sp_mat& P, const CommClasses& commClasses, 
+                       const StationaryOptions& options, vector<StationarySolve>& solves) {
+  // Largest class solved with a dense direct method by default
+  const int denseLimit = 1000;
+  int m = P.n_cols;
+  vector<int> closedIndex(commClasses.numClasses, -1);
+  int numClosed = 0;
+  
+  for (int c = 0; c < commClasses.numClasses; ++c)
+    if (commClasses.closed[c])
+      closedIndex[c] = numClosed++;
+  
+  vector<vector<uword>> members(numClosed);
+  vector<int> position(m, -1);
+  
+  for (int i = 0; i < m; ++i) {
+    int c = closedIndex[commClasses.component[i]];
     
-    ++steadyStateIndex;
+    if (c >= 0) {
+      position[i] = members[c].size();
+      members[c].push_back(i);
+    }
   }
   
-  colnames(steady) = states;
+  mat result(numClosed, m, fill::zeros);
+  vector<int> failed(numClosed, false);
+  solves.assign(numClosed, StationarySolve());
+  
+  syncForWorkers(P);
+  ClassSteadyStates worker(P, members, position, options, denseLimit, result, solves, failed);
+  parallelFor(0, numClosed, worker);
+  
+  if (count(failed.begin(), failed.end(), true) > 0)
+    stop("Failure computing eigen values / vectors for submatrix in steadyStateErgodicMatrix");
+  
+  return result;
+}
+
+// One steady state per recurrent class, by rows
+NumericMatrix steadyStatesByRecurrentClasses(const CompiledChain& chain, 
+                                             const StationaryOptions& options,
+                                             vector<StationarySolve>& solves) {
+  NumericMatrix steady = wrap(steadyStatesKernel(sp_mat(chain.probs), chain.commClasses, 
+                                                 options, solves));
+  colnames(steady) = chain.states;
   
   return steady;
 }
 
-// [[Rcpp::export(.steadyStatesRcpp)]]
-NumericMatrix steadyStates(S4 obj) {
-  NumericMatrix transitions = obj.slot("transitionMatrix");
-  CharacterVector states = obj.slot("states");
-  bool byrow = obj.slot("byrow");
-  S4 object("markovchain");
+// Same as above, solving every class with the default method
+NumericMatrix steadyStatesByRecurrentClasses(const CompiledChain& chain) {
+  StationaryOptions options = {"auto", 1e-12, 10000, 1};
+  vector<StationarySolve> solves;
   
-  if (!byrow) {
-    object.slot("transitionMatrix") = transpose(transitions);
-    object.slot("states") = states;
-    object.slot("byrow") = true;
+  return steadyStatesByRecurrentClasses(chain, options, solves);
+}
+
+// Steady states of a markovchain, a compiled one or a dgCMatrix stochastic 
+// by rows. With diagnostics = true, the result carries a data.frame with 
+// the method, iterations, residual and convergence of each closed class
+// [[Rcpp::export(.steadyStatesRcpp)]]
+NumericMatrix steadyStates(SEXP obj, String method = "auto", double tolerance = 1e-12, 
+                           int maxit = 10000, double omega = 1, bool diagnostics = false) {
+  StationaryOptions options = {method, tolerance, maxit, omega};
+  vector<StationarySolve> solves;
+  NumericMatrix result;
+  bool byrow = true;
+  
+  if (options.method != "auto" && options.method != "direct" && options.method != "power" &&
+      options.method != "gaussSeidel" && options.method != "sor")
+    stop("method must be one of auto, direct, power, gaussSeidel or sor");
+  
+  if (options.method == "sor" && (omega <= 0 || omega >= 2))
+    stop("omega must be in (0, 2)");
+  
+  if (Rf_inherits(obj, "dgCMatrix")) {
+    sp_mat P = as<sp_mat>(obj);
+    
+    if (P.n_rows != P.n_cols)
+      stop("The transition matrix must be square");
+    
+    result = wrap(steadyStatesKernel(P, commClassesKernel(P), options, solves));
+    List dimnames = S4(obj).slot("Dimnames");
+    
+    if (!Rf_isNull(dimnames[1]))
+      colnames(result) = dimnames[1];
   } else {
-    object = obj;
+    // Compute steady states using recurrent classes (there is 
+    // exactly one steady state associated with each recurrent class)
+    XPtr<CompiledChain> chain = compiledChain(obj);
+    result = steadyStatesByRecurrentClasses(*chain, options, solves);
+    byrow = chain->byrow;
   }
   
-  // Compute steady states using recurrent classes (there is 
-  // exactly one steady state associated with each recurrent class)
-  NumericMatrix result = lexicographicalSort(steadyStatesByRecurrentClasses(object));
+  int notConverged = 0;
+  
+  for (const StationarySolve& solve : solves)
+    if (!solve.converged)
+      ++notConverged;
+  
+  if (notConverged > 0)
+    warning("Steady state solver did not converge in %d iterations for %d classes", 
+            maxit, notConverged);
+  
+  vector<int> order;
+  result = lexicographicalSort(result, order);
   
   if (!byrow)
     result = transpose(result);
   
+  if (diagnostics) {
+    int numSolves = solves.size();
+    IntegerVector classIndex(numSolves), size(numSolves), iterations(numSolves);
+    CharacterVector methods(numSolves);
+    NumericVector residual(numSolves);
+    LogicalVector converged(numSolves);
+    
+    // Row k describes the solve behind the k-th steady state
+    for (int k = 0; k < numSolves; ++k) {
+      const StationarySolve& solve = solves[order[k]];
+      classIndex[k] = k + 1;
+      size[k] = solve.pi.n_elem;
+      methods[k] = solve.method;
+      iterations[k] = solve.iterations;
+      residual[k] = solve.residual;
+      converged[k] = solve.converged;
+    }
+    
+    result.attr("diagnostics") = DataFrame::create(_["class"] = classIndex, 
+                                                   _["size"] = size,
+                                                   _["method"] = methods, 
+                                                   _["iterations"] = iterations,
+                                                   _["residual"] = residual, 
+                                                   _["converged"] = converged,
+                                                   _["stringsAsFactors"] = false);
+  }
+  
   return result;
 }
 
@@ -1172,86 +2257,94 @@ NumericMatrix steadyStates(S4 obj) {
 // This method is agnostic on whether the matrix is stochastic 
 // by rows or by columns, we just need the diagonal
 // [[Rcpp::export(.absorbingStatesRcpp)]]
-CharacterVector absorbingStates(S4 obj) {
-  NumericMatrix transitionMatrix = obj.slot("transitionMatrix");
-  CharacterVector states = obj.slot("states");
+CharacterVector absorbingStates(SEXP obj) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
   CharacterVector absorbing;
-  int numStates = states.size();
   
-  for (int i = 0; i < numStates; ++i)
-    if (approxEqual(transitionMatrix(i, i), 1))
-      absorbing.push_back(states(i));
+  for (int i = 0; i < chain->numStates; ++i)
+    if (approxEqual(chain->probs(i, i), 1))
+      absorbing.push_back(chain->states(i));
     
   return absorbing;
 }
 
 
 // [[Rcpp::export(.isIrreducibleRcpp)]]
-bool isIrreducible(S4 obj) {
-  List commClasses = communicatingClasses(obj);
+bool isIrreducible(SEXP obj) {
   // The markov chain is irreducible iff has only a single communicating class
-  return commClasses.size() == 1;
+  return compiledChain(obj)->commClasses.numClasses == 1;
 }
 
 
+// A chain is regular (its matrix primitive) iff it is irreducible and
+// aperiodic. Both are read from the graph of the chain in O(V + E)
+//
+// With powers = true it is decided instead from the positivity of a power 
+// of the matrix (Matrix Analysis. Roger A.Horn, Charles R.Johnson. 
+// 2nd edition. Corollary 8.5.8 and Theorem 8.5.9), which is O(m³ log m)
+// and only kept as a cross-check
 // [[Rcpp::export(.isRegularRcpp)]]
-bool isRegular(S4 obj) {
-  NumericMatrix transitions = obj.slot("transitionMatrix");
-  int m = transitions.ncol();
-  mat probs(transitions.begin(), m, m, true);
-  mat reachable;
-  // Let alias this as d
+bool isRegular(SEXP obj, bool powers = false) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  int m = chain->numStates;
+  
+  if (!powers)
+    return chain->commClasses.numClasses == 1 && chain->periodicity().period[0] == 1;
+  
+  // Work on the zero pattern, so that no entry underflows to zero
+  mat pattern(m, m);
   int positiveDiagonal = 0;
   auto arePositive = [](const double& x){ return x > 0; };
+  auto toPattern = [](double x){ return x > 0 ? 1.0 : 0.0; };
+  
+  for (int j = 0; j < m; ++j)
+    for (int i = 0; i < m; ++i)
+      pattern(i, j) = toPattern(chain->probs(i, j));
   
-  // Count positive elements in the diagonal
   for (int i = 0; i < m; ++i)
-    if (probs(i, i) > 0)
+    if (pattern(i, i) > 0)
       ++positiveDiagonal;
   
-  // Taken from the book: 
-  // Matrix Analysis. Roger A.Horn, Charles R.Johnson. 2nd edition. 
-  // Corollary 8.5.8 and Theorem 8.5.9
-  //
   // If A is irreducible and has 0 < d positive diagonal elements
   //   A is regular and $A^{2m - d - 1} > 0
   //
   // A is regular iff A^{m²- 2m + 2} > 0
-  if (positiveDiagonal > 0)
-    reachable = matrixPow(probs, 2*m - positiveDiagonal - 1);
-  else
-    reachable = matrixPow(probs, m*m - 2*m + 2);
+  int n = positiveDiagonal > 0 ? 2*m - positiveDiagonal - 1 : m*m - 2*m + 2;
+  mat result = eye(m, m);
+  
+  while (n > 0) {
+    if ((n & 1) > 0) {
+      result = result * pattern;
+      result.transform(toPattern);
+    }
+    
+    pattern = pattern * pattern;
+    pattern.transform(toPattern);
+    n >>= 1;
+  }
   
-  return allElements(reachable, arePositive);
+  return allElements(result, arePositive);
 }
 
 
-NumericMatrix computeMeanAbsorptionTimes(mat& probs, CharacterVector& absorbing, 
-                                         CharacterVector& states) {
-  unordered_set<string> toErase;
-  vector<uint> indicesToKeep;
-  CharacterVector newNames;
-  string current;
+// Mean number of steps needed to reach the destination states from the
+// remaining ones, solving (I - Q) t = 1 with Q the block of the latter
+NumericMatrix computeMeanAbsorptionTimes(const CompiledChain& chain, 
+                                         const vector<int>& destination) {
+  vector<bool> isDestination(chain.numStates, false);
+  vector<int> remaining;
   
-  for (auto state : absorbing)
-    toErase.insert((string) state);
+  for (int state : destination)
+    isDestination[state] = true;
   
-  // Compute the states which are not in absorbing
-  // and subset the sub-probability matrix of those
-  // states which are not considered absorbing, Q
-  for (uint i = 0; i < states.size(); ++i) {
-    current = (string) states(i);
-    
-    if (toErase.count(current) == 0) {
-      indicesToKeep.push_back(i);
-      newNames.push_back(current);
-    }
-  }
+  for (int i = 0; i < chain.numStates; ++i)
+    if (!isDestination[i])
+      remaining.push_back(i);
   
-  int n = indicesToKeep.size();
-  uvec indices(indicesToKeep);
+  int n = remaining.size();
+  uvec indices = toIndices(remaining);
   // Comppute N = 1 - Q
-  mat coeffs = eye(n, n) - probs(indices, indices);
+  mat coeffs = eye(n, n) - chain.probs(indices, indices);
   vec rightPart = vec(n, fill::ones);
   mat meanTimes;
   
@@ -1261,177 +2354,275 @@ NumericMatrix computeMeanAbsorptionTimes(mat& probs, CharacterVector& absorbing,
     stop("Error solving system in meanAbsorptionTime");
   
   NumericMatrix result = wrap(meanTimes);
-  rownames(result) = newNames;
+  rownames(result) = chain.statesAt(remaining);
   
   return result;
 }
 
 
 // [[Rcpp::export(.meanAbsorptionTimeRcpp)]]
-NumericVector meanAbsorptionTime(S4 obj) {
-  NumericMatrix transitions = obj.slot("transitionMatrix");
-  CharacterVector states = obj.slot("states");
-  bool byrow = obj.slot("byrow");
-  unordered_set<string> allStates;
-  
-  if (!byrow)
-    transitions = transpose(transitions);
-  
-  // Compute recurrent and transient states
-  List commKernel = commClassesKernel(transitions);
-  LogicalVector closed = commKernel["closed"];
-  CharacterVector transient = computeTransientStates(states, closed);
-  CharacterVector recurrent = computeRecurrentStates(states, closed);
-  
-  // Compute the mean absorption time for the transient states
-  mat probs(transitions.begin(), transitions.nrow(), transitions.ncol(), true);
-  NumericMatrix meanTimes = computeMeanAbsorptionTimes(probs, recurrent, states);
+NumericVector meanAbsorptionTime(SEXP obj) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  int n = chain->transient.size();
   NumericVector result;
   
-  if (meanTimes.ncol() > 0) {
-    result = meanTimes(_, 0);
-    result.attr("names") = transient;
+  // Mean absorbing times A are computed as (I - Q) * A = 1,
+  // where 1 is a column vector of 1s
+  if (n > 0) {
+    mat meanTimes = chain->solveTransient(ones<mat>(n, 1));
+    result = NumericVector(meanTimes.begin(), meanTimes.end());
   }
   
+  result.attr("names") = chain->statesAt(chain->transient);
+  
   return result;
 }
 
 // [[Rcpp::export(.absorptionProbabilitiesRcpp)]]
-NumericMatrix absorptionProbabilities(S4 obj) {
-  NumericMatrix transitions = obj.slot("transitionMatrix");
-  CharacterVector states = obj.slot("states");
-  string current;
-  bool byrow = obj.slot("byrow");
-  if (!byrow)
-    transitions = transpose(transitions);
+NumericMatrix absorptionProbabilities(SEXP obj) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
   
-  unordered_map<string, uint> stateToIndex;
+  if (chain->transient.size() == 0)
+    stop("Markov chain does not have transient states, method not applicable");
   
-  // Map each state to the index it has
-  for (int i = 0; i < states.size(); ++i) {
-    current = (string) states[i];
-    stateToIndex[current] = i;
-  }
+  uvec transientIndices = toIndices(chain->transient);
+  uvec recurrentIndices = toIndices(chain->recurrent);
   
-  List commKernel = commClassesKernel(transitions);
-  LogicalVector closed = commKernel["closed"];
-  CharacterVector transient = computeTransientStates(states, closed);
-  CharacterVector recurrent = computeRecurrentStates(states, closed);
+  // Compute the mean absorption probabilities as F* = N*P[transient, recurrent],
+  // where N = (1 - Q)^{-1}, solving against the cached factorisation
+  mat meanProbs = chain->solveTransient(chain->probs(transientIndices, recurrentIndices));
+  NumericMatrix result = wrap(meanProbs);
+  rownames(result) = chain->statesAt(chain->transient);
+  colnames(result) = chain->statesAt(chain->recurrent);
   
-  vector<uint> transientIndxs, recurrentIndxs;
+  if (!chain->byrow)
+    result = transpose(result);
   
-  // Compute the indexes of the matrix which correspond to transient and recurrent states
-  for (auto state : transient) {
-    current = (string) state;
-    transientIndxs.push_back(stateToIndex[current]);
-  }
+  return result;
+}
+
+// [[Rcpp::export(.varianceAbsorptionTimeRcpp)]]
+NumericVector varianceAbsorptionTime(SEXP obj) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  int n = chain->transient.size();
+  NumericVector result;
   
-  for (auto state : recurrent) {
-    current = (string) state;
-    recurrentIndxs.push_back(stateToIndex[current]);
+  // With N = (I - Q)^{-1} and t = N 1 the mean absorption times, the 
+  // variances are (2N - I) t - t^2. Both products with N are solves
+  // against the cached factorisation
+  if (n > 0) {
+    vec meanTimes = chain->solveTransient(ones<mat>(n, 1));
+    vec variances = 2 * vec(chain->solveTransient(meanTimes)) - meanTimes - square(meanTimes);
+    result = NumericVector(variances.begin(), variances.end());
   }
   
-  int m = transitions.ncol();
-  int n = transientIndxs.size();
+  result.attr("names") = chain->statesAt(chain->transient);
+  
+  return result;
+}
+
+// Columns of the fundamental matrix N = (I - Q)^{-1} for the given transient
+// states (all of them if empty). N(i, j) is the expected number of visits 
+// to j before absorption when starting at i. Only the requested columns are
+// solved, N is never formed as an inverse
+// [[Rcpp::export(.fundamentalMatrixRcpp)]]
+NumericMatrix fundamentalMatrix(SEXP obj, CharacterVector states = CharacterVector()) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  int n = chain->transient.size();
   
   if (n == 0)
     stop("Markov chain does not have transient states, method not applicable");
   
-  // Get the indices in arma::uvec s
-  uvec transientIndices(transientIndxs);
-  uvec recurrentIndices(recurrentIndxs);
+  vector<int> position(chain->numStates, -1);
+  vector<int> columns;
+  
+  for (int k = 0; k < n; ++k)
+    position[chain->transient[k]] = k;
   
-  // Compute N = (1 - Q)^{-1}
-  mat probs(transitions.begin(), m, m, true);
-  mat toInvert = eye(n, n) - probs(transientIndices, transientIndices);
-  mat fundamentalMatrix;
+  if (states.size() > 0) {
+    for (int state : chain->indicesOf(states, "Some of the states you provided do not match states from the markovchain")) {
+      if (position[state] < 0)
+        stop("Only transient states can be given to fundamentalMatrix");
+      
+      columns.push_back(state);
+    }
+  } else {
+    columns = chain->transient;
+  }
   
-  if (!inv(fundamentalMatrix, toInvert))
-    stop("Could not compute fundamental matrix");
+  int numColumns = columns.size();
+  mat rightPart(n, numColumns, fill::zeros);
   
-  // Compute the mean absorption probabilities as F* = N*P[transient, recurrent]
-  mat meanProbs = fundamentalMatrix * probs(transientIndices, recurrentIndices);
-  NumericMatrix result = wrap(meanProbs);
-  rownames(result) = transient;
-  colnames(result) = recurrent;
+  for (int k = 0; k < numColumns; ++k)
+    rightPart(position[columns[k]], k) = 1;
   
-  if (!byrow)
+  NumericMatrix result = wrap(chain->solveTransient(rightPart));
+  rownames(result) = chain->statesAt(chain->transient);
+  colnames(result) = chain->statesAt(columns);
+  
+  if (!chain->byrow)
     result = transpose(result);
   
   return result;
 }
 
-// [[Rcpp::export(.meanFirstPassageTimeRcpp)]]
-NumericMatrix meanFirstPassageTime(S4 obj, CharacterVector destination) {
-  bool isErgodic = isIrreducible(obj);
+// Discrete phase-type distribution of the time to absorption, for each 
+// starting distribution over the transient states (rows of initial). If 
+// u_n holds the mass still in the transient states after n steps, then
+// P(T = n + 1) = u_n r, with r the probabilities of leaving the transient
+// states in one step, and u_{n + 1} = u_n Q. Each step is a product with
+// the sparse transient block, so the cost is O(n nnz(Q)) per starting 
+// distribution. The recursion stops once the mass left for every starting
+// distribution is below tolerance
+// [[Rcpp::export(.absorptionTimeDistributionRcpp)]]
+List absorptionTimeDistribution(SEXP obj, int n, NumericMatrix initial, 
+                                double tolerance = 0) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  int m = chain->transient.size();
+  int k = initial.nrow();
+  
+  if (m == 0)
+    stop("Markov chain does not have transient states, method not applicable");
   
-  if (!isErgodic)
-    stop("Markov chain needs to be ergodic (= irreducile) for this method to work");
-  else {
-    NumericMatrix transitions = obj.slot("transitionMatrix");
-    mat probs(transitions.begin(), transitions.nrow(), transitions.ncol(), true);
-    CharacterVector states = obj.slot("states");
-    bool byrow = obj.slot("byrow");
-    int numStates = states.size();
-    NumericMatrix result;
-    
-    if (!byrow)
-      probs = probs.t();
-    
-    if (destination.size() > 0) {
-      result = computeMeanAbsorptionTimes(probs, destination, states);
-      // This transpose is intentional to return a row always instead of a column
-      result = transpose(result);
-      return result;
-    } else {
-      result = NumericMatrix(numStates, numStates);
-      vec steadyState = steadyStateErgodicMatrix(probs);
-      mat toInvert(numStates, numStates);
-      mat Z;
-      
-      // Compute inverse for (I - P + W), where P = probs,
-      // and W = steadyState pasted row-wise
-      for (int i = 0; i < numStates; ++i) {
-        for (int j = 0; j < numStates; ++j) {
-          toInvert(i, j) = -probs(i, j) + steadyState(j);
-          
-          if (i == j)
-            toInvert(i, i) += 1;
-        }
-      }
-      
-      if (!inv(Z, toInvert))
-        stop("Problem computing inverse of matrix inside meanFirstPassageTime");
-      
-      // Set the result matrix
-      for (int j = 0; j < numStates; ++j) {
-        double r_j = 1.0 / steadyState(j);
-        
-        for (int i = 0; i < numStates; ++i) {
-          result(i, j) = (Z(j,j) - Z(i,j)) * r_j;
-        }
-      }
+  if (initial.ncol() != m)
+    stop("initial must have one column per transient state");
+  
+  if (n < 1)
+    stop("n must be a positive integer");
+  
+  uvec indices = toIndices(chain->transient);
+  mat Q = chain->probs(indices, indices);
+  vec exits = 1 - sum(Q, 1);
+  sp_mat transposed(Q.t());
+  // One column per starting distribution
+  mat mass = mat(initial.begin(), k, m).t();
+  mat density(k, n, fill::zeros);
+  mat distribution(k, n);
+  // Mass not given to the transient states is absorbed at time zero
+  vec cumulative = 1 - vec(sum(mass, 0).t());
+  int steps = 0;
+  
+  while (steps < n) {
+    vec absorbed = mass.t() * exits;
+    cumulative += absorbed;
+    density.col(steps) = absorbed;
+    distribution.col(steps) = cumulative;
+    mass = transposed * mass;
+    ++steps;
     
-      colnames(result) = states;
-      rownames(result) = states;
+    if (tolerance > 0 && max(vec(sum(mass, 0).t())) < tolerance)
+      break;
+  }
+  
+  // Past the early stop the densities stay at zero
+  for (int step = steps; step < n; ++step)
+    distribution.col(step) = cumulative;
+  
+  return List::create(_["density"] = density, 
+                      _["distribution"] = distribution,
+                      _["steps"] = steps);
+}
+
+// Solves the columns of Z = (I - P + 1 pi^T)^{-1} belonging to the target
+// states, blockSize columns per task. Each task writes its own columns of
+// the result, so no synchronisation is needed
+struct FundamentalColumns : public Worker {
+  const LUFactors& factors;
+  const vector<int>& targets;
+  const size_t blockSize;
+  mat& Z;
+  
+  FundamentalColumns(const LUFactors& factors, const vector<int>& targets,
+                     size_t blockSize, mat& Z)
+    : factors(factors), targets(targets), blockSize(blockSize), Z(Z) {}
+  
+  void operator()(size_t begin, size_t end) {
+    int n = Z.n_rows;
+    
+    for (size_t block = begin; block < end; ++block) {
+      size_t first = block * blockSize;
+      size_t last = std::min(first + blockSize, targets.size());
+      mat rightPart(n, last - first, fill::zeros);
       
-      if (!byrow)
-        result = transpose(result);
+      for (size_t k = first; k < last; ++k)
+        rightPart(targets[k], k - first) = 1;
       
-      return result;
+      Z.cols(first, last - 1) = factors.solve(rightPart);
     }
   }
-}
+};
 
-// [[Rcpp::export(.meanRecurrenceTimeRcpp)]]
-NumericVector meanRecurrenceTime(S4 obj) {
-  NumericMatrix steady = steadyStates(obj);
-  bool byrow = obj.slot("byrow");
+// Mean first passage times to the states in targets (all of them when 
+// empty), or, if destination is not empty, the mean time to reach any of
+// the states in destination. The fundamental system is factorised once per
+// chain and only the requested columns are solved, in parallel blocks
+// [[Rcpp::export(.meanFirstPassageTimeRcpp)]]
+NumericMatrix meanFirstPassageTime(SEXP obj, CharacterVector destination, 
+                                   CharacterVector targets = CharacterVector()) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  bool isErgodic = chain->commClasses.numClasses == 1;
   
-  if (!byrow)
-    steady = transpose(steady);
+  if (!isErgodic)
+    stop("Markov chain needs to be ergodic (= irreducile) for this method to work");
+  
+  const char* wrongStates = "Some of the states you provided do not match states from the markovchain";
+  NumericMatrix result;
+  
+  if (destination.size() > 0) {
+    result = computeMeanAbsorptionTimes(*chain, chain->indicesOf(destination, wrongStates));
+    // This transpose is intentional to return a row always instead of a column
+    result = transpose(result);
+    return result;
+  }
+  
+  int numStates = chain->numStates;
+  vector<int> targetIndices;
+  
+  if (targets.size() > 0)
+    targetIndices = chain->indicesOf(targets, wrongStates);
+  else
+    for (int j = 0; j < numStates; ++j)
+      targetIndices.push_back(j);
+  
+  const LUFactors& factors = chain->fundamental();
+  const vec& steadyState = chain->stationaryDistribution();
+  size_t numTargets = targetIndices.size();
+  size_t blockSize = 64;
+  size_t numBlocks = (numTargets + blockSize - 1) / blockSize;
+  mat Z(numStates, numTargets);
+  
+  FundamentalColumns solver(factors, targetIndices, blockSize, Z);
+  
+  if (numBlocks > 1)
+    parallelFor(0, numBlocks, solver);
+  else
+    solver(0, numBlocks);
+  
+  // M(i, j) = (Z(j, j) - Z(i, j)) / pi_j
+  result = NumericMatrix(numStates, numTargets);
+  
+  for (size_t k = 0; k < numTargets; ++k) {
+    int j = targetIndices[k];
+    double r_j = 1.0 / steadyState(j);
     
-  CharacterVector states = obj.slot("states");
+    for (int i = 0; i < numStates; ++i)
+      result(i, k) = (Z(j, k) - Z(i, k)) * r_j;
+  }
+  
+  colnames(result) = chain->statesAt(targetIndices);
+  rownames(result) = chain->states;
+  
+  if (!chain->byrow)
+    result = transpose(result);
+  
+  return result;
+}
+
+// [[Rcpp::export(.meanRecurrenceTimeRcpp)]]
+NumericVector meanRecurrenceTime(SEXP obj) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  NumericMatrix steady = lexicographicalSort(steadyStatesByRecurrentClasses(*chain));
+  CharacterVector states = chain->states;
   NumericVector result;
   CharacterVector recurrentStates;
   
@@ -1456,15 +2647,12 @@ NumericVector meanRecurrenceTime(S4 obj) {
 }
 
 // [[Rcpp::export(.minNumVisitsRcpp)]]
-NumericMatrix meanNumVisits(S4 obj) {
-  NumericMatrix hitting = hittingProbabilities(obj);
-  CharacterVector states = obj.slot("states");
-  bool byrow = obj.slot("byrow");
-  
-  if (!byrow)
-    hitting = transpose(hitting);
-  
-  int n = hitting.ncol();
+NumericMatrix meanNumVisits(SEXP obj) {
+  XPtr<CompiledChain> chain = compiledChain(obj);
+  mat hitting = hittingProbabilitiesKernel(*chain);
+  CharacterVector states = chain->states;
+  bool byrow = chain->byrow;
+  int n = hitting.n_cols;
   bool closeToOne;
   double inverse;
   NumericMatrix result(n, n);
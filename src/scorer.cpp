@@ -0,0 +1,151 @@
+// [[Rcpp::depends(RcppParallel)]]
+#include <Rcpp.h>
+#include <RcppParallel.h>
+#include <markovchain/scorer.h>
+
+using namespace Rcpp;
+using namespace RcppParallel;
+using namespace std;
+using markovchain::Scorer;
+
+// Declared in utils.cpp
+SEXP handlePointer(SEXP handle, const char* message);
+
+// Log-likelihoods of a batch of sequences of state positions, each range of
+// sequences carried by its own thread
+struct SequenceLikelihoods : public Worker {
+  const Scorer& scorer;
+  const vector<vector<int>>& sequences;
+  vector<double>& results;
+  
+  SequenceLikelihoods(const Scorer& scorer, const vector<vector<int>>& sequences,
+                      vector<double>& results)
+    : scorer(scorer), sequences(sequences), results(results) {}
+  
+  void operator()(size_t begin, size_t end) {
+    for (size_t k = begin; k < end; ++k)
+      results[k] = scorer.logLikelihood(sequences[k]);
+  }
+};
+
+// The scorer behind a markovchainScorer object
+XPtr<Scorer> scorerOf(S4 object) {
+  return XPtr<Scorer>(handlePointer(object, 
+    "The scorer is no longer valid, compile the markovchain again"));
+}
+
+// Positions of the given states, -1 for the missing ones
+vector<int> positionsOf(const Scorer& scorer, CharacterVector states) {
+  vector<int> positions(states.size());
+  
+  for (int i = 0; i < states.size(); ++i) {
+    if (CharacterVector::is_na(states[i])) {
+      positions[i] = -1;
+    } else {
+      positions[i] = scorer.index(as<string>(states[i]));
+  
+      if (positions[i] < 0)
+        stop("%s is not a state of the markovchain", as<string>(states[i]));
+    }
+  }
+  
+  return positions;
+}
+
+// [[Rcpp::export(.compileScorerRcpp)]]
+SEXP compileScorer(S4 object, double floor, int k) {
+  NumericMatrix transitions = object.slot("transitionMatrix");
+  CharacterVector states = object.slot("states");
+  bool byrow = object.slot("byrow");
+  int numStates = states.size();
+  vector<double> probs(numStates * numStates);
+  
+  // The table of the scorer is row-major and stochastic by rows
+  for (int i = 0; i < numStates; ++i)
+    for (int j = 0; j < numStates; ++j)
+      probs[i * numStates + j] = byrow ? transitions(i, j) : transitions(j, i);
+  
+  return XPtr<Scorer>(new Scorer(as<vector<string>>(states), probs, floor, k), true);
+}
+
+// Distributions of the next state from each of the states, one per row
+// [[Rcpp::export(.nextStateProbabilitiesRcpp)]]
+NumericMatrix nextStateProbabilities(S4 object, CharacterVector from, bool logarithm) {
+  XPtr<Scorer> scorer = scorerOf(object);
+  vector<int> positions = positionsOf(*scorer, from);
+  int numStates = scorer->size();
+  NumericMatrix result(from.size(), numStates);
+  CharacterVector states(numStates);
+  
+  for (int i = 0; i < from.size(); ++i) {
+    if (positions[i] < 0)
+      stop("from can not contain missing states");
+  
+    const double* row = scorer->logRow(positions[i]);
+  
+    for (int j = 0; j < numStates; ++j)
+      result(i, j) = logarithm ? row[j] : exp(row[j]);
+  }
+  
+  for (int j = 0; j < numStates; ++j)
+    states[j] = scorer->state(j);
+  
+  rownames(result) = from;
+  colnames(result) = states;
+  
+  return result;
+}
+
+// The k most probable successors of each of the states with their
+// probabilities, k being at most the one given when compiling
+// [[Rcpp::export(.topSuccessorsRcpp)]]
+List topSuccessors(S4 object, CharacterVector from, int k) {
+  XPtr<Scorer> scorer = scorerOf(object);
+  vector<int> positions = positionsOf(*scorer, from);
+  int numSuccessors = std::min<int>(std::max(k, 0), scorer->numSuccessors());
+  List result(from.size());
+  
+  for (int i = 0; i < from.size(); ++i) {
+    if (positions[i] < 0)
+      stop("from can not contain missing states");
+  
+    const int* successors = scorer->successors(positions[i]);
+    NumericVector probs(numSuccessors);
+    CharacterVector names(numSuccessors);
+  
+    for (int j = 0; j < numSuccessors; ++j) {
+      probs[j] = exp(scorer->logProb(positions[i], successors[j]));
+      names[j] = scorer->state(successors[j]);
+    }
+  
+    probs.names() = names;
+    result[i] = probs;
+  }
+  
+  result.names() = from;
+  
+  return result;
+}
+
+// Log-likelihoods of the transitions of each sequence, those from or to a
+// missing state being skipped
+// [[Rcpp::export(.sequenceLogLikelihoodRcpp)]]
+NumericVector sequenceLogLikelihood(S4 object, List sequences) {
+  XPtr<Scorer> scorer = scorerOf(object);
+  int numSequences = sequences.size();
+  vector<vector<int>> positions(numSequences);
+  vector<double> results(numSequences);
+  
+  // States are looked up here, the threads only read the table
+  for (int k = 0; k < numSequences; ++k)
+    positions[k] = positionsOf(*scorer, sequences[k]);
+  
+  SequenceLikelihoods likelihoods(*scorer, positions, results);
+  
+  if (numSequences > 1)
+    parallelFor(0, numSequences, likelihoods);
+  else
+    likelihoods(0, numSequences);
+  
+  return wrap(results);
+}
@@ -9,30 +9,128 @@ using namespace Rcpp;
 using namespace arma;
 using namespace std;
 
-// Defined in probabilistic.cpp
-bool isAccessible(S4 obj, String from, String to);
+// The pointer slot of an S4 handle to native memory, such as a 
+// compiledMarkovchain. Handles do not survive a save and reload of the
+// session, which leaves the pointer null; message then tells how to build
+// the handle again
+SEXP handlePointer(SEXP handle, const char* message) {
+  SEXP pointer = S4(handle).slot("pointer");
+  
+  if (R_ExternalPtrAddr(pointer) == NULL)
+    stop(message);
+  
+  return pointer;
+}
 
-// Defined in probabilistic.cpp
-LogicalMatrix reachabilityMatrix(S4 obj);
+// Armadillo refreshes the element cache of a sparse matrix lazily, even on
+// const reads. Syncing it before sharing the matrix leaves it safe for 
+// concurrent reads from RcppParallel workers
+void syncForWorkers(const sp_mat& matrix) {
+  matrix.sync();
+}
 
-// matrix power function
-// O(log n * m³) where m is the number of rows / cols of A
-mat matrixPow(const mat& A, int n) {
-  int m = A.n_rows;
-  mat result  = eye(m, m);
-  mat partial = A;
-  
-  // We can decompose n = 2^a + 2^b + 2^c ... with a > b > c >= 0
-  // Compute last = a + 1
-  while (n > 0) {
-    if ((n & 1) > 0)
-      result = result + partial;
-    
-    partial = partial * partial;
-    n >>= 1;
+// Iterative Tarjan's algorithm over a graph in compressed form: the
+// successors of node i are targets[offsets[i]], ..., targets[offsets[i + 1] - 1]
+// Fills component with the class id of each node, numbering the classes
+// by their smallest node, and closed with whether each class can be left.
+// Returns the number of classes. O(n + e), no recursion
+int stronglyConnectedComponents(const vector<int>& offsets, const vector<int>& targets,
+                                vector<int>& component, vector<bool>& closed) {
+  int n = offsets.size() - 1;
+  vector<int> index(n, -1);
+  vector<int> lowlink(n, 0);
+  vector<int> nextEdge(n, 0);
+  vector<bool> onStack(n, false);
+  vector<int> tarjanStack;
+  vector<int> callStack;
+  vector<int> found(n, -1);
+  int counter = 0;
+  int numClasses = 0;
+  
+  for (int root = 0; root < n; ++root) {
+    if (index[root] != -1)
+      continue;
+  
+    index[root] = lowlink[root] = counter++;
+    nextEdge[root] = offsets[root];
+    onStack[root] = true;
+    tarjanStack.push_back(root);
+    callStack.push_back(root);
+  
+    while (!callStack.empty()) {
+      int v = callStack.back();
+  
+      if (nextEdge[v] < offsets[v + 1]) {
+        int w = targets[nextEdge[v]++];
+  
+        if (index[w] == -1) {
+          index[w] = lowlink[w] = counter++;
+          nextEdge[w] = offsets[w];
+          onStack[w] = true;
+          tarjanStack.push_back(w);
+          callStack.push_back(w);
+        } else if (onStack[w]) {
+          lowlink[v] = std::min(lowlink[v], index[w]);
+        }
+      } else {
+        callStack.pop_back();
+  
+        // v is the root of a class: pop the whole class
+        if (lowlink[v] == index[v]) {
+          int w;
+  
+          do {
+            w = tarjanStack.back();
+            tarjanStack.pop_back();
+            onStack[w] = false;
+            found[w] = numClasses;
+          } while (w != v);
+  
+          ++numClasses;
+        }
+  
+        if (!callStack.empty()) {
+          int u = callStack.back();
+          lowlink[u] = std::min(lowlink[u], lowlink[v]);
+        }
+      }
+    }
   }
   
-  return result;
+  // Renumber the classes in order of their smallest node
+  vector<int> renumber(numClasses, -1);
+  int next = 0;
+  component.assign(n, 0);
+  
+  for (int i = 0; i < n; ++i) {
+    if (renumber[found[i]] == -1)
+      renumber[found[i]] = next++;
+  
+    component[i] = renumber[found[i]];
+  }
+  
+  // A class is closed if there is no edge leaving it
+  closed.assign(numClasses, true);
+  
+  for (int i = 0; i < n; ++i)
+    for (int k = offsets[i]; k < offsets[i + 1]; ++k)
+      if (component[targets[k]] != component[i])
+        closed[component[i]] = false;
+  
+  return numClasses;
+}
+
+// One seed for the random generator of each of the given number of
+// independent simulations, drawn from R's RNG so set.seed is honoured.
+// Must be called from the main thread
+vector<unsigned long long> pathSeeds(int paths) {
+  vector<unsigned long long> seeds(paths);
+  
+  for (int p = 0; p < paths; ++p)
+    seeds[p] = ((unsigned long long) (unif_rand() * 4294967296.0) << 32) +
+               (unsigned long long) (unif_rand() * 4294967296.0);
+  
+  return seeds;
 }
 
 // check if two vectors are intersected
@@ -138,25 +236,6 @@ bool isProbVector(NumericVector prob) {
   return result && approxEqual(sumProbs, 1);
 }
 
-// [[Rcpp::export(.testthatIsAccesibleRcpp)]]
-bool checkIsAccesibleMethod(S4 obj) {
-  CharacterVector states = obj.slot("states");
-  bool byrow = obj.slot("byrow");
-  LogicalMatrix reachability = reachabilityMatrix(obj);
-  int m = states.size();
-  bool correct = true;
-  bool reachable;
-  
-  for (int i = 0; i < m && correct; ++i) {
-    for (int j = 0; j < m && correct; ++j) {
-      reachable = (byrow ? reachability(i, j) : reachability(j, i));
-      correct = isAccessible(obj, states(i), states(j)) == reachable;
-    }
-  }
-  
-  return correct;
-}
-
 // [[Rcpp::export(.approxEqualMatricesRcpp)]]
 bool approxEqual(NumericMatrix a, NumericMatrix b) {
   int a_ncol = a.ncol();